@@ -0,0 +1,983 @@
+#pragma once
+
+/// 描画処理のベンチマーク。実機(Demo.ino)とホスト(host/main.cpp)の両方で使う。
+/// 各項目を runs 回計測し、最小・中央値・99パーセンタイルの時間と
+/// 中央値から求めた pixel/s・byte/s を text / CSV / JSON で出力する。
+
+#include <LovyanGFX.hpp>
+#include "pixel_kernels.hpp"
+#include "SDRAM_Arena.hpp"
+#include "SDRAM_DMA.hpp"
+#include "GlyphCache.hpp"
+#include "SDRAM_Sprite.hpp"
+#include "LGFX_LTDC_Device.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#if defined (ARDUINO_ARCH_STM32)
+#include "stm32746g_discovery_sdram.h"
+#endif
+
+namespace bench
+{
+    struct result_t
+    {
+        const char* name;
+        int rotation;      // 回転に依存しない項目は -1
+        uint32_t runs;
+        uint32_t min_us;
+        uint32_t median_us;
+        uint32_t p99_us;
+        uint32_t pixels;   // 1回あたりの画素数
+        uint32_t bytes;    // 1回あたりの転送量
+
+        /// 中央値が 0us の場合は 0
+        unsigned long pixelsPerSec(void) const { return per_sec(pixels); }
+        unsigned long bytesPerSec(void) const { return per_sec(bytes); }
+
+    private:
+        unsigned long per_sec(uint32_t n) const
+        {
+            if (!median_us) return 0;
+            uint64_t v = (uint64_t)n * 1000000u / median_us;
+            return v > ULONG_MAX ? ULONG_MAX : (unsigned long)v;
+        }
+    };
+
+    class Benchmark
+    {
+    public:
+        enum format_t
+        {
+            format_text,
+            format_csv,
+            format_json,
+        };
+
+        static constexpr uint32_t max_runs = 64;
+
+        /// out には1行ずつ(改行を含む)文字列が渡される
+        Benchmark(void (*out)(const char*), format_t format = format_csv, uint32_t runs = 16)
+        : _out(out)
+        , _format(format)
+        , _runs(std::min(std::max<uint32_t>(runs, 1), max_runs))
+        {}
+
+        void begin(void)
+        {
+            _count = 0;
+            switch (_format)
+            {
+            case format_csv:
+                _out("name,rotation,runs,min_us,median_us,p99_us,pixels,bytes,px_per_s,bytes_per_s\n");
+                break;
+            case format_json:
+                _out("[\n");
+                break;
+            default:
+                _out("name                     rot    min    med    p99 (us)      px/s        B/s\n");
+                break;
+            }
+        }
+
+        void end(void)
+        {
+            if (_format == format_json)
+            {
+                _out(_count ? "\n]\n" : "]\n");
+            }
+        }
+
+        /// setup は計測に含めない前処理、body を計測する。
+        /// pixels/bytes は body 1回あたりの処理量
+        template <typename TSetup, typename TBody>
+        result_t run(const char* name, int rotation, uint32_t pixels, uint32_t bytes,
+                     TSetup&& setup, TBody&& body)
+        {
+            uint32_t samples[max_runs];
+            for (uint32_t i = 0; i < _runs; ++i)
+            {
+                setup();
+                uint32_t start = lgfx::micros();
+                body();
+                samples[i] = lgfx::micros() - start;
+            }
+            std::sort(samples, samples + _runs);
+
+            result_t r;
+            r.name      = name;
+            r.rotation  = rotation;
+            r.runs      = _runs;
+            r.min_us    = samples[0];
+            r.median_us = samples[_runs >> 1];
+            r.p99_us    = samples[(_runs * 99 + 99) / 100 - 1];
+            r.pixels    = pixels;
+            r.bytes     = bytes;
+            print(r);
+            return r;
+        }
+
+        template <typename TBody>
+        result_t run(const char* name, int rotation, uint32_t pixels, uint32_t bytes, TBody&& body)
+        {
+            return run(name, rotation, pixels, bytes, []{}, body);
+        }
+
+        void print(const result_t& r)
+        {
+            char buf[256];
+            switch (_format)
+            {
+            case format_csv:
+                snprintf(buf, sizeof(buf), "%s,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+                         r.name, r.rotation, (unsigned long)r.runs,
+                         (unsigned long)r.min_us, (unsigned long)r.median_us, (unsigned long)r.p99_us,
+                         (unsigned long)r.pixels, (unsigned long)r.bytes,
+                         r.pixelsPerSec(), r.bytesPerSec());
+                break;
+
+            case format_json:
+                snprintf(buf, sizeof(buf),
+                         "%s  {\"name\":\"%s\",\"rotation\":%d,\"runs\":%lu,"
+                         "\"min_us\":%lu,\"median_us\":%lu,\"p99_us\":%lu,"
+                         "\"pixels\":%lu,\"bytes\":%lu,\"px_per_s\":%lu,\"bytes_per_s\":%lu}",
+                         _count ? ",\n" : "",
+                         r.name, r.rotation, (unsigned long)r.runs,
+                         (unsigned long)r.min_us, (unsigned long)r.median_us, (unsigned long)r.p99_us,
+                         (unsigned long)r.pixels, (unsigned long)r.bytes,
+                         r.pixelsPerSec(), r.bytesPerSec());
+                break;
+
+            default:
+                snprintf(buf, sizeof(buf), "%-24s %3d %6lu %6lu %6lu %12lu %10lu\n",
+                         r.name, r.rotation,
+                         (unsigned long)r.min_us, (unsigned long)r.median_us, (unsigned long)r.p99_us,
+                         r.pixelsPerSec(), r.bytesPerSec());
+                break;
+            }
+            _out(buf);
+            ++_count;
+        }
+
+        uint32_t getRuns(void) const { return _runs; }
+
+    private:
+        void (*_out)(const char*);
+        format_t _format;
+        uint32_t _runs;
+        uint32_t _count = 0;
+    };
+
+    /// Demo.ino の各テストと同じ図形を計測する。
+    /// image は 128x128 画素以上の RGB565 の作業領域 (pushImage/readRect に使う)
+    inline void run_standard_suite(Benchmark& b, lgfx::LGFX_Device& gfx, uint16_t* image)
+    {
+        uint32_t bpp = (gfx.getColorDepth() & lgfx::color_depth_t::bit_mask) >> 3;
+        auto clear = [&]{ gfx.fillScreen(TFT_BLACK); };
+
+        gfx.setRotation(0);
+        int32_t w = gfx.width();
+        int32_t h = gfx.height();
+        int32_t cx = w / 2;
+        int32_t cy = h / 2;
+
+        b.run("fill_screen", -1, w * h, w * h * bpp,
+              [&]{ gfx.fillScreen(TFT_RED); });
+
+        {
+            static constexpr const char* text = "Hello World! 1234.56";
+            gfx.setTextSize(2);
+            gfx.setTextColor(TFT_WHITE, TFT_BLACK);
+            uint32_t px = gfx.textWidth(text) * gfx.fontHeight();
+            b.run("text", -1, px, px * bpp, clear,
+                  [&]{ gfx.drawString(text, 0, 0); });
+            gfx.setTextSize(1);
+        }
+
+        {
+            uint32_t px = 0;
+            for (int32_t x = 0; x < w; x += 6) { px += std::max(x, h - 1) + 1; }
+            for (int32_t y = 0; y < h; y += 6) { px += std::max(w - 1, y) + 1; }
+            b.run("lines", -1, px, px * bpp, clear, [&]
+            {
+                for (int32_t x = 0; x < w; x += 6) { gfx.drawLine(0, 0, x, h - 1, TFT_CYAN); }
+                for (int32_t y = 0; y < h; y += 6) { gfx.drawLine(0, 0, w - 1, y, TFT_CYAN); }
+            });
+        }
+
+        {
+            uint32_t px = (w / 5 + 1) * w + (h / 5 + 1) * h;
+            b.run("fast_hv_lines", -1, px, px * bpp, clear, [&]
+            {
+                for (int32_t y = 0; y < h; y += 5) { gfx.drawFastHLine(0, y, w, TFT_RED); }
+                for (int32_t x = 0; x < w; x += 5) { gfx.drawFastVLine(x, 0, h, TFT_BLUE); }
+            });
+        }
+
+        {
+            int32_t n = std::min(w, h);
+            uint32_t px = 0;
+            for (int32_t i = 2; i < n; i += 6) { px += 4 * i - 4; }
+            b.run("rects", -1, px, px * bpp, clear, [&]
+            {
+                for (int32_t i = 2; i < n; i += 6)
+                {
+                    gfx.drawRect(cx - i / 2, cy - i / 2, i, i, TFT_GREEN);
+                }
+            });
+
+            px = 0;
+            for (int32_t i = n - 1; i > 6; i -= 6) { px += i * i; }
+            b.run("filled_rects", -1, px, px * bpp, clear, [&]
+            {
+                for (int32_t i = n - 1; i > 6; i -= 6)
+                {
+                    gfx.fillRect(cx - i / 2, cy - i / 2, i, i, TFT_YELLOW);
+                }
+            });
+        }
+
+        {
+            static constexpr int32_t r = 10;
+            uint32_t count = ((w + 2 * r - 1) / (2 * r)) * ((h + 2 * r - 1) / (2 * r));
+            uint32_t px = count * (uint32_t)(3.14159f * r * r);
+            b.run("filled_circles", -1, px, px * bpp, clear, [&]
+            {
+                for (int32_t x = r; x < w; x += r * 2)
+                {
+                    for (int32_t y = r; y < h; y += r * 2) { gfx.fillCircle(x, y, r, TFT_MAGENTA); }
+                }
+            });
+            px = count * (uint32_t)(2 * 3.14159f * r);
+            b.run("circles", -1, px, px * bpp, clear, [&]
+            {
+                for (int32_t x = r; x < w; x += r * 2)
+                {
+                    for (int32_t y = r; y < h; y += r * 2) { gfx.drawCircle(x, y, r, TFT_WHITE); }
+                }
+            });
+        }
+
+        {
+            int32_t n = std::min(cx, cy);
+            uint32_t px = 0;
+            for (int32_t i = n; i > 10; i -= 5) { px += i * i * 2; }
+            b.run("filled_triangles", -1, px, px * bpp, clear, [&]
+            {
+                for (int32_t i = n; i > 10; i -= 5)
+                {
+                    gfx.fillTriangle(cx, cy - i, cx - i, cy + i, cx + i, cy + i, TFT_ORANGE);
+                }
+            });
+            px = 0;
+            for (int32_t i = 0; i < n; i += 5) { px += i * 7; }
+            b.run("triangles", -1, px, px * bpp, clear, [&]
+            {
+                for (int32_t i = 0; i < n; i += 5)
+                {
+                    gfx.drawTriangle(cx, cy - i, cx - i, cy + i, cx + i, cy + i, TFT_GREEN);
+                }
+            });
+        }
+
+        {
+            int32_t n = std::min(w, h);
+            uint32_t px = 0;
+            for (int32_t i = n; i > 20; i -= 6) { px += i * i; }
+            b.run("filled_round_rects", -1, px, px * bpp, clear, [&]
+            {
+                for (int32_t i = n; i > 20; i -= 6)
+                {
+                    gfx.fillRoundRect(cx - i / 2, cy - i / 2, i, i, i / 8, TFT_GREEN);
+                }
+            });
+            px = 0;
+            for (int32_t i = 0; i < n; i += 6) { px += 4 * i; }
+            b.run("round_rects", -1, px, px * bpp, clear, [&]
+            {
+                for (int32_t i = 0; i < n; i += 6)
+                {
+                    gfx.drawRoundRect(cx - i / 2, cy - i / 2, i, i, i / 8, TFT_RED);
+                }
+            });
+        }
+
+        /// 回転ごとの転送
+        static constexpr int32_t iw = 128;
+        static constexpr int32_t ih = 128;
+        for (int i = 0; i < iw * ih; ++i)
+        {
+            image[i] = lgfx::color565(i, i >> 7, i >> 5);
+        }
+        for (int r = 0; r < 8; ++r)
+        {
+            gfx.setRotation(r);
+            uint32_t px = iw * ih;
+            b.run("push_image", r, px, px * bpp,
+                  [&]{ gfx.pushImage(0, 0, iw, ih, (lgfx::swap565_t*)image); });
+            b.run("read_rect", r, px, px * bpp,
+                  [&]{ gfx.readRect(0, 0, iw, ih, (lgfx::swap565_t*)image); });
+            px = gfx.width() * gfx.height() / 4;
+            b.run("fill_rect", r, px, px * bpp,
+                  [&]{ gfx.fillRect(0, 0, gfx.width() / 2, gfx.height() / 2, TFT_BLUE); });
+        }
+        gfx.setRotation(0);
+    }
+
+    /// run_standard_suite の filled_* と同じ図形を、LGFX_LTDC_Device の区間をまとめて塗る実装で描く。
+    /// 水平線が縦に並ぶ 90度 (rotation 1) も計測する
+    inline void run_span_suite(Benchmark& b, lgfx::LGFX_LTDC_Device& gfx)
+    {
+        uint32_t bpp = (gfx.getColorDepth() & lgfx::color_depth_t::bit_mask) >> 3;
+        auto clear = [&]{ gfx.fillScreen(TFT_BLACK); };
+
+        for (int rot = 0; rot < 2; ++rot)
+        {
+            gfx.setRotation(rot);
+            int32_t w = gfx.width();
+            int32_t h = gfx.height();
+            int32_t cx = w / 2;
+            int32_t cy = h / 2;
+            {
+                static constexpr int32_t r = 10;
+                uint32_t count = ((w + 2 * r - 1) / (2 * r)) * ((h + 2 * r - 1) / (2 * r));
+                uint32_t px = count * (uint32_t)(3.14159f * r * r);
+                b.run("filled_circles_spans", rot, px, px * bpp, clear, [&]
+                {
+                    for (int32_t x = r; x < w; x += r * 2)
+                    {
+                        for (int32_t y = r; y < h; y += r * 2) { gfx.fillCircle(x, y, r, TFT_MAGENTA); }
+                    }
+                });
+            }
+            {
+                int32_t n = std::min(cx, cy);
+                uint32_t px = 0;
+                for (int32_t i = n; i > 10; i -= 5) { px += i * i * 2; }
+                b.run("filled_triangles_spans", rot, px, px * bpp, clear, [&]
+                {
+                    for (int32_t i = n; i > 10; i -= 5)
+                    {
+                        gfx.fillTriangle(cx, cy - i, cx - i, cy + i, cx + i, cy + i, TFT_ORANGE);
+                    }
+                });
+            }
+            {
+                int32_t n = std::min(w, h);
+                uint32_t px = 0;
+                for (int32_t i = n; i > 20; i -= 6) { px += i * i; }
+                b.run("filled_round_rects_spans", rot, px, px * bpp, clear, [&]
+                {
+                    for (int32_t i = n; i > 20; i -= 6)
+                    {
+                        gfx.fillRoundRect(cx - i / 2, cy - i / 2, i, i, i / 8, TFT_GREEN);
+                    }
+                });
+            }
+        }
+        gfx.setRotation(0);
+    }
+
+    /// 斜めの線を LGFX_LTDC_Device (Panel_LTDC が直接描く) で描く。lines_native は run_standard_suite の lines と同じ図形。
+    /// polyline_* は画面幅いっぱいの折れ線グラフを、LovyanGFX の drawLine で1本ずつ描いた場合と drawPolyline で比べる
+    inline void run_line_suite(Benchmark& b, lgfx::LGFX_LTDC_Device& gfx)
+    {
+        uint32_t bpp = (gfx.getColorDepth() & lgfx::color_depth_t::bit_mask) >> 3;
+        auto clear = [&]{ gfx.fillScreen(TFT_BLACK); };
+
+        gfx.setRotation(0);
+        int32_t w = gfx.width();
+        int32_t h = gfx.height();
+        {
+            uint32_t px = 0;
+            for (int32_t x = 0; x < w; x += 6) { px += std::max(x, h - 1) + 1; }
+            for (int32_t y = 0; y < h; y += 6) { px += std::max(w - 1, y) + 1; }
+            b.run("lines_native", -1, px, px * bpp, clear, [&]
+            {
+                for (int32_t x = 0; x < w; x += 6) { gfx.drawLine(0, 0, x, h - 1, TFT_CYAN); }
+                for (int32_t y = 0; y < h; y += 6) { gfx.drawLine(0, 0, w - 1, y, TFT_CYAN); }
+            });
+        }
+        {
+            static constexpr uint32_t max_points = 480;
+            static lgfx::Panel_LTDC::point_t points[max_points];
+            uint32_t count = std::min<uint32_t>(w, max_points);
+            uint32_t px = 0;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                points[i].x = i;
+                points[i].y = h / 2 + (int32_t)((i * 37) % 97) - 48;
+                if (i)
+                {
+                    px += std::max(1, std::abs(points[i].y - points[i - 1].y)) + 1;
+                }
+            }
+            b.run("polyline_lines", -1, px, px * bpp, clear, [&]
+            {
+                gfx.setColor(TFT_GREEN);
+                for (uint32_t i = 1; i < count; ++i)
+                {
+                    gfx.LGFX_Device::drawLine(points[i - 1].x, points[i - 1].y, points[i].x, points[i].y);
+                }
+            });
+            b.run("polyline_native", -1, px, px * bpp, clear,
+                  [&]{ gfx.drawPolyline(points, count, TFT_GREEN); });
+        }
+    }
+
+    /// 半透明の矩形・ARGB8888 の画像・A8 のマスクを重ねる。*_lgfx は LovyanGFX の実装 (readRect と書き戻し)、
+    /// *_native は Panel_LTDC がフレームバッファ上で直接重ねる場合。RGB565 以外では両方とも LovyanGFX の実装になる
+    inline void run_alpha_suite(Benchmark& b, lgfx::LGFX_LTDC_Device& gfx)
+    {
+        uint32_t bpp = (gfx.getColorDepth() & lgfx::color_depth_t::bit_mask) >> 3;
+        auto clear = [&]{ gfx.fillScreen(TFT_NAVY); };
+
+        static constexpr int32_t n = 64;
+        static uint32_t image[n * n];
+        static uint8_t mask[n * n];
+        for (int32_t y = 0; y < n; ++y)
+        {
+            for (int32_t x = 0; x < n; ++x)
+            {
+                /// 中心から外側へ薄くなる円 (縁がアンチエイリアスされた図形と同じく、alpha が 0・255 以外の画素を含む)
+                int32_t dx = x * 2 - n + 1, dy = y * 2 - n + 1;
+                int32_t a = std::max(0, 255 - (dx * dx + dy * dy) * 255 / (n * n));
+                mask[x + y * n] = a;
+                image[x + y * n] = (uint32_t)a << 24 | (x * 4) << 16 | (y * 4) << 8 | 0x80;
+            }
+        }
+        auto data = (const lgfx::argb8888_t*)image;
+
+        for (int rot = 0; rot < 2; ++rot)
+        {
+            gfx.setRotation(rot);
+            int32_t w = gfx.width();
+            int32_t h = gfx.height();
+            {
+                uint32_t px = w * h / 2;
+                b.run("alpha_fill_lgfx", rot, px, px * bpp * 2, clear,
+                      [&]{ gfx.LGFX_Device::fillRectAlpha(w / 4, 0, w / 2, h, 128, TFT_WHITE); });
+                b.run("alpha_fill_native", rot, px, px * bpp * 2, clear,
+                      [&]{ gfx.fillRectAlpha(w / 4, 0, w / 2, h, 128, TFT_WHITE); });
+            }
+            {
+                uint32_t count = (w / n) * (h / n);
+                uint32_t px = count * n * n;
+                auto draw = [&](bool native)
+                {
+                    for (int32_t y = 0; y + n <= h; y += n)
+                    {
+                        for (int32_t x = 0; x + n <= w; x += n)
+                        {
+                            if (native) { gfx.pushAlphaImage(x, y, n, n, data); }
+                            else        { gfx.LGFX_Device::pushAlphaImage(x, y, n, n, data); }
+                        }
+                    }
+                };
+                b.run("alpha_image_lgfx", rot, px, px * bpp * 2, clear, [&]{ draw(false); });
+                b.run("alpha_image_native", rot, px, px * bpp * 2, clear, [&]{ draw(true); });
+                b.run("alpha_mask_native", rot, px, px * bpp * 2, clear, [&]
+                {
+                    for (int32_t y = 0; y + n <= h; y += n)
+                    {
+                        for (int32_t x = 0; x + n <= w; x += n) { gfx.pushAlphaMask(x, y, n, n, mask, TFT_YELLOW); }
+                    }
+                });
+            }
+        }
+        gfx.setRotation(0);
+    }
+
+    /// 透過色を持つスプライト (64x64、表示と同じ色深度) を画面全体に並べて描く。
+    /// sprite_opaque は透過なし、sprite_key は pushSprite() の透過色 (writeImage で画素を比べる)、
+    /// sprite_mask は SpriteMask の区間の表を使う場合。スプライトと区間の表は arena に置く
+    inline void run_sprite_suite(Benchmark& b, lgfx::LGFX_LTDC_Device& gfx, lgfx::SDRAM_Arena& arena)
+    {
+        static constexpr int32_t n = 64;
+        uint32_t bpp = (gfx.getColorDepth() & lgfx::color_depth_t::bit_mask) >> 3;
+        LGFX_Sprite sprite(&gfx);
+        if (!lgfx::createSpriteInArena(sprite, arena, n, n, gfx.getColorDepth()))
+        {
+            return;
+        }
+        /// 黒 (生の値が 0) を透過色として、穴の空いた円を描く
+        sprite.fillScreen(TFT_BLACK);
+        sprite.fillCircle(n / 2, n / 2, n / 2 - 2, TFT_ORANGE);
+        sprite.fillCircle(n / 2, n / 2, n / 4, TFT_BLACK);
+        sprite.fillRect(n / 2 - 2, 0, 4, n, TFT_BLACK);
+        lgfx::SpriteMask mask;
+        if (!mask.build(arena, sprite.getBuffer(), n, n, bpp, 0))
+        {
+            lgfx::deleteSpriteInArena(sprite, arena);
+            return;
+        }
+        auto clear = [&]{ gfx.fillScreen(TFT_NAVY); };
+
+        for (int rot = 0; rot < 2; ++rot)
+        {
+            gfx.setRotation(rot);
+            int32_t w = gfx.width();
+            int32_t h = gfx.height();
+            uint32_t count = (w / n) * (h / n);
+            uint32_t px = count * n * n;
+            auto draw = [&](int mode)
+            {
+                for (int32_t y = 0; y + n <= h; y += n)
+                {
+                    for (int32_t x = 0; x + n <= w; x += n)
+                    {
+                        switch (mode)
+                        {
+                        case 0:  sprite.pushSprite(&gfx, x, y); break;
+                        case 1:  sprite.pushSprite(&gfx, x, y, 0u); break;
+                        default: gfx.pushImageMasked(x, y, sprite.getBuffer(), mask); break;
+                        }
+                    }
+                }
+            };
+            b.run("sprite_opaque", rot, px, px * bpp, clear, [&]{ draw(0); });
+            b.run("sprite_key", rot, px, px * bpp, clear, [&]{ draw(1); });
+            b.run("sprite_mask", rot, px, px * bpp, clear, [&]{ draw(2); });
+        }
+        gfx.setRotation(0);
+        mask.release();
+        lgfx::deleteSpriteInArena(sprite, arena);
+    }
+
+    /// スプライトを画面の中央に拡大・縮小して描く (pushRotateZoom の角度0)。
+    /// _affine は角度を 1度にして、列の表を使わない従来の経路 (fp_copy) と比べる。
+    /// _bilinear は Panel_LTDC::setBilinearScaling() を有効にしたもの (RGB565 のみ補間する)
+    inline void run_zoom_suite(Benchmark& b, lgfx::LGFX_LTDC_Device& gfx, lgfx::Panel_LTDC& panel, lgfx::SDRAM_Arena& arena)
+    {
+        static constexpr int32_t n = 64;
+        uint32_t bpp = (gfx.getColorDepth() & lgfx::color_depth_t::bit_mask) >> 3;
+        LGFX_Sprite sprite(&gfx);
+        if (!lgfx::createSpriteInArena(sprite, arena, n, n, gfx.getColorDepth()))
+        {
+            return;
+        }
+        for (int32_t y = 0; y < n; ++y)
+        {
+            for (int32_t x = 0; x < n; ++x)
+            {
+                sprite.drawPixel(x, y, lgfx::color565(x * 4, y * 4, 255 - x * 2));
+            }
+        }
+        auto clear = [&]{ gfx.fillScreen(TFT_NAVY); };
+
+        gfx.setRotation(0);
+        float cx = gfx.width() * 0.5f;
+        float cy = gfx.height() * 0.5f;
+        auto zoom = [&](const char* name, float angle, float z)
+        {
+            uint32_t px = (uint32_t)(n * z) * (uint32_t)(n * z);
+            b.run(name, 0, px, px * bpp, clear, [&]{ sprite.pushRotateZoom(&gfx, cx, cy, angle, z, z); });
+        };
+        zoom("zoom_2x", 0, 2);
+        zoom("zoom_3x", 0, 3);
+        zoom("zoom_4x", 0, 4);
+        zoom("zoom_1_5x", 0, 1.5f);
+        zoom("zoom_0_5x", 0, 0.5f);
+        zoom("zoom_2x_affine", 1, 2);
+        panel.setBilinearScaling(true);
+        zoom("zoom_2x_bilinear", 0, 2);
+        zoom("zoom_1_5x_bilinear", 0, 1.5f);
+        panel.setBilinearScaling(false);
+        lgfx::deleteSpriteInArena(sprite, arena);
+    }
+
+    /// パネルの描画関数を直接呼び、1画素・小さな矩形 (DMA2D を使わない大きさ)・区間の書き込みを回転ごとに計測する。
+    /// Panel_LTDC と Panel_LTDC_T を比べるため、名前は prefix_pixels のようになる。gfx は panel を使う LGFX_Device
+    inline void run_panel_suite(Benchmark& b, lgfx::LGFX_Device& gfx, lgfx::Panel_LTDC& panel, const char* prefix)
+    {
+        static char names[3][32];
+        auto label = [&](int i, const char* item)
+        {
+            snprintf(names[i], sizeof(names[i]), "%s_%s", prefix, item);
+            return names[i];
+        };
+        const char* pixels_name = label(0, "pixels");
+        const char* fills_name  = label(1, "small_fills");
+        const char* spans_name  = label(2, "spans");
+        uint32_t bpp = (gfx.getColorDepth() & lgfx::color_depth_t::bit_mask) >> 3;
+
+        static constexpr uint32_t n = 64;
+        for (int r = 0; r < 8; ++r)
+        {
+            gfx.setRotation(r);
+            gfx.startWrite();
+            uint32_t px = n * n;
+            b.run(pixels_name, r, px, px * bpp, [&]
+            {
+                for (uint32_t y = 0; y < n; ++y)
+                {
+                    for (uint32_t x = 0; x < n; ++x) { panel.drawPixelPreclipped(x, y, x ^ y); }
+                }
+            });
+            b.run(fills_name, r, px, px * bpp, [&]
+            {
+                for (uint32_t y = 0; y < n; y += 4)
+                {
+                    for (uint32_t x = 0; x < n; x += 4) { panel.writeFillRectPreclipped(x, y, 4, 4, x + y); }
+                }
+                panel.waitDMA();
+            });
+            lgfx::Panel_LTDC::span_t spans[n];
+            for (uint32_t i = 0; i < n; ++i)
+            {
+                spans[i] = { (uint16_t)(i & 15), (uint16_t)i, (uint16_t)(n - 16) };
+            }
+            px = n * (n - 16) * 16;
+            b.run(spans_name, r, px, px * bpp, [&]
+            {
+                for (uint32_t i = 0; i < 16; ++i) { panel.fillSpans(spans, n, i); }
+            });
+            gfx.endWrite();
+        }
+        gfx.setRotation(0);
+    }
+
+    /// copyRect による画面全体のスクロール。scroll_line は1行(8画素)、scroll_page は半画面分ずらす。
+    /// 比較用に readRect と pushImage で同じ移動をした場合 (*_readrect) も計測する。
+    /// work は画面全体の RGB565 が入る作業領域
+    inline void run_scroll_suite(Benchmark& b, lgfx::LGFX_Device& gfx, uint16_t* work)
+    {
+        uint32_t bpp = (gfx.getColorDepth() & lgfx::color_depth_t::bit_mask) >> 3;
+        for (int r = 0; r < 2; ++r)
+        {
+            gfx.setRotation(r);
+            int32_t w = gfx.width();
+            int32_t h = gfx.height();
+            for (int32_t dy : { 8, h / 2 })
+            {
+                /// 移動した画素ごとに読み出しと書き込みがある
+                uint32_t px = w * (h - dy);
+                bool line = dy == 8;
+                b.run(line ? "scroll_line" : "scroll_page", r, px, px * bpp * 2,
+                      [&]{ gfx.copyRect(0, 0, w, h - dy, 0, dy); });
+                b.run(line ? "scroll_line_readrect" : "scroll_page_readrect", r, px, px * bpp * 2, [&]
+                {
+                    gfx.readRect(0, dy, w, h - dy, (lgfx::swap565_t*)work);
+                    gfx.pushImage(0, 0, w, h - dy, (lgfx::swap565_t*)work);
+                });
+            }
+        }
+        gfx.setRotation(0);
+    }
+
+    /// 文字列の描画を drawString と GlyphCache で比べる。pixels 列は文字数なので、px/s が毎秒の文字数になる。
+    /// *_transparent は背景を描かない場合。*_cached はグリフを載せた後に計測する
+    inline void run_text_suite(Benchmark& b, lgfx::LGFX_Device& gfx, lgfx::GlyphCache& cache)
+    {
+        static constexpr const char* text = "Hello World! 1234.56 The quick brown fox";
+        uint32_t bpp = (gfx.getColorDepth() & lgfx::color_depth_t::bit_mask) >> 3;
+        uint32_t glyphs = strlen(text);
+        auto clear = [&]{ gfx.fillScreen(TFT_BLACK); };
+
+        gfx.setRotation(0);
+        gfx.setTextSize(2);
+        uint32_t bytes = gfx.textWidth(text) * gfx.fontHeight() * bpp;
+        for (bool transparent : { false, true })
+        {
+            if (transparent) { gfx.setTextColor(TFT_WHITE); }
+            else             { gfx.setTextColor(TFT_WHITE, TFT_BLACK); }
+            b.run(transparent ? "text_glyphs_transparent" : "text_glyphs", -1, glyphs, bytes, clear,
+                  [&]{ gfx.drawString(text, 0, 0); });
+            cache.drawString(text, 0, 0);
+            b.run(transparent ? "text_glyphs_transparent_cached" : "text_glyphs_cached", -1, glyphs, bytes, clear,
+                  [&]{ cache.drawString(text, 0, 0); });
+        }
+        gfx.setTextSize(1);
+    }
+
+    /// kernels::fill の画素サイズ・長さごとの性能。比較用に memset も計測する。
+    /// 短い長さは計測の分解能(1us)に届くよう繰り返し、pixels/bytes はその合計。
+    /// 項目名の末尾が1回に埋める画素数。buf は 480x272x4+4 バイト以上
+    inline void run_fill_suite(Benchmark& b, uint8_t* buf)
+    {
+        static constexpr uint32_t spans[] = { 1, 7, 32, 480, 4096, 480 * 136, 480 * 272 };
+        static constexpr size_t span_count = sizeof(spans) / sizeof(spans[0]);
+        static char names[5][span_count][24];
+
+        for (uint32_t bytes = 1; bytes <= 5; ++bytes)
+        {
+            for (size_t i = 0; i < span_count; ++i)
+            {
+                uint32_t span = spans[i];
+                uint32_t reps = std::max<uint32_t>(1, 65536 / span);
+                char* name = names[bytes - 1][i];
+                if (bytes == 5)
+                {
+                    /// memset で 32bit の画素を埋めた場合
+                    snprintf(name, sizeof(names[0][0]), "memset_32bit_%lu", (unsigned long)span);
+                    b.run(name, -1, span * reps, span * reps * 4, [&]
+                    {
+                        for (uint32_t r = 0; r < reps; ++r) { memset(buf, 0x5A, span * 4); }
+                    });
+                    continue;
+                }
+                snprintf(name, sizeof(names[0][0]), "fill_%lubit_%lu",
+                         (unsigned long)bytes * 8, (unsigned long)span);
+                /// 画素の先頭が4バイト境界に揃わない場合も含める
+                uint8_t* dst = buf + (span < 64 ? bytes : 0);
+                b.run(name, -1, span * reps, span * reps * bytes, [&]
+                {
+                    for (uint32_t r = 0; r < reps; ++r)
+                    {
+                        lgfx::kernels::fill(dst, 0x123456u, bytes, span);
+                    }
+                });
+            }
+        }
+    }
+
+    /// SDRAM の内部バンクごとの CPU の塗りつぶし・コピーの性能。LTDC の表示中に呼ぶ。
+    /// arena.setBankSize() を設定しておくこと。各バンクに 128KiB の領域を2つずつ確保し、
+    /// bank_fill_<n> はバンク n の塗りつぶし、bank_copy_<s>_to_<d> はバンク s から d へのコピー。
+    /// 表示中のフレームバッファと同じバンク・同じバンク内のコピーで遅くなる分が配置による差になる
+    inline void run_bank_suite(Benchmark& b, lgfx::SDRAM_Arena& arena)
+    {
+        static constexpr size_t max_banks = 4;
+        static constexpr size_t len = 128 * 1024;
+        static char names[max_banks * (max_banks + 1)][24];
+        uint8_t* src[max_banks] = {};
+        uint8_t* dst[max_banks] = {};
+
+        size_t banks = std::min(arena.getBankCount(), max_banks);
+        for (size_t i = 0; i < banks; ++i)
+        {
+            src[i] = (uint8_t*)arena.allocInBanks(len, 1u << i);
+            dst[i] = (uint8_t*)arena.allocInBanks(len, 1u << i);
+        }
+
+        char* name = names[0];
+        for (size_t d = 0; d < banks; ++d)
+        {
+            if (!dst[d]) continue;
+            snprintf(name, sizeof(names[0]), "bank_fill_%u", (unsigned)d);
+            b.run(name, -1, len / 4, len, [&]
+            {
+                lgfx::kernels::fill(dst[d], 0x12345678u, 4, len / 4);
+            });
+            name += sizeof(names[0]);
+        }
+        for (size_t s = 0; s < banks; ++s)
+        {
+            for (size_t d = 0; d < banks; ++d)
+            {
+                if (!src[s] || !dst[d]) continue;
+                snprintf(name, sizeof(names[0]), "bank_copy_%u_to_%u", (unsigned)s, (unsigned)d);
+                b.run(name, -1, len / 4, len * 2, [&]
+                {
+                    memcpy(dst[d], src[s], len);
+                });
+                name += sizeof(names[0]);
+            }
+        }
+
+        for (size_t i = 0; i < banks; ++i)
+        {
+            arena.free(src[i]);
+            arena.free(dst[i]);
+        }
+    }
+
+    /// SDRAM の読み書き・コピーの転送速度。sram は内蔵SRAMの作業領域で、その大きさ(最大64KiB)を転送の単位にする。
+    /// read は SDRAM から、write は SDRAM へ、copy は SDRAM 内の転送。
+    /// word は32bitずつの CPU のアクセス、stride<n> は n バイトおきに全てのワードをたどる順のアクセス、
+    /// memcpy・kernel (kernels::move_bytes)・bsp (BSP_SDRAM_*Data)・bsp_dma (BSP_SDRAM_*Data_DMA)・dma (SDRAM_DMA) は手段の違い。
+    /// 項目名の末尾は scanout が true なら _scan、false なら _noscan。LTDC の表示を止めた場合との差が
+    /// scanout が使う帯域になる。ホストでは通常のメモリを計測し、カーネルの性能の基準にする
+    inline void run_sdram_suite(Benchmark& b, lgfx::SDRAM_Arena& arena, uint32_t* sram, size_t sram_bytes,
+                                lgfx::SDRAM_DMA* dma, bool scanout)
+    {
+        static char names[24][32];
+        char* name = names[0];
+        const char* suffix = scanout ? "scan" : "noscan";
+        auto label = [&](const char* item)
+        {
+            snprintf(name, sizeof(names[0]), "sdram_%s_%s", item, suffix);
+            const char* result = name;
+            name += sizeof(names[0]);
+            return result;
+        };
+
+        size_t len = std::min<size_t>(sram_bytes, 64 * 1024) & ~3u;
+        uint32_t words = len >> 2;
+        auto src = (uint32_t*)arena.alloc(len);
+        auto dst = (uint32_t*)arena.alloc(len);
+        if (!len || !src || !dst)
+        {
+            arena.free(src);
+            arena.free(dst);
+            return;
+        }
+        memset(src, 0x5A, len);
+        memset(sram, 0xA5, len);
+
+        /// 読み出した値を捨てないよう、合計を sram に書き出しておく
+        b.run(label("read_word"), -1, words, len, [&]
+        {
+            auto s = (volatile uint32_t*)src;
+            uint32_t sum = 0;
+            for (uint32_t i = 0; i < words; ++i) { sum += s[i]; }
+            sram[0] = sum;
+        });
+        b.run(label("write_word"), -1, words, len, [&]
+        {
+            auto d = (volatile uint32_t*)dst;
+            for (uint32_t i = 0; i < words; ++i) { d[i] = i; }
+        });
+        b.run(label("copy_word"), -1, words, len * 2, [&]
+        {
+            auto s = (volatile uint32_t*)src;
+            auto d = (volatile uint32_t*)dst;
+            for (uint32_t i = 0; i < words; ++i) { d[i] = s[i]; }
+        });
+
+        /// 32 はキャッシュライン・バースト、2048 は SDRAM の行(512バイト)をまたぐ間隔
+        for (uint32_t stride : { 32u, 2048u })
+        {
+            uint32_t step = std::min<uint32_t>(stride, len) >> 2;
+            b.run(label(stride == 32 ? "read_stride32" : "read_stride2k"), -1, words, len, [&]
+            {
+                auto s = (volatile uint32_t*)src;
+                uint32_t sum = 0;
+                for (uint32_t o = 0; o < step; ++o)
+                {
+                    for (uint32_t i = o; i < words; i += step) { sum += s[i]; }
+                }
+                sram[0] = sum;
+            });
+            b.run(label(stride == 32 ? "write_stride32" : "write_stride2k"), -1, words, len, [&]
+            {
+                auto d = (volatile uint32_t*)dst;
+                for (uint32_t o = 0; o < step; ++o)
+                {
+                    for (uint32_t i = o; i < words; i += step) { d[i] = i; }
+                }
+            });
+        }
+
+        b.run(label("read_memcpy"), -1, words, len, [&]{ memcpy(sram, src, len); });
+        b.run(label("write_memcpy"), -1, words, len, [&]{ memcpy(dst, sram, len); });
+        b.run(label("copy_memcpy"), -1, words, len * 2, [&]{ memcpy(dst, src, len); });
+        b.run(label("copy_kernel"), -1, words, len * 2, [&]
+        {
+            lgfx::kernels::move_bytes((uint8_t*)dst, (const uint8_t*)src, len);
+        });
+
+#if defined (ARDUINO_ARCH_STM32)
+        b.run(label("read_bsp"), -1, words, len, [&]
+        {
+            BSP_SDRAM_ReadData((uint32_t)src, sram, words);
+        });
+        b.run(label("write_bsp"), -1, words, len, [&]
+        {
+            BSP_SDRAM_WriteData((uint32_t)dst, sram, words);
+        });
+        b.run(label("read_bsp_dma"), -1, words, len, [&]
+        {
+            BSP_SDRAM_ReadData_DMA((uint32_t)src, sram, words);
+            while (BSP_SDRAM_DMA_IsBusy());
+        });
+        b.run(label("write_bsp_dma"), -1, words, len, [&]
+        {
+            BSP_SDRAM_WriteData_DMA((uint32_t)dst, sram, words);
+            while (BSP_SDRAM_DMA_IsBusy());
+        });
+#endif
+
+        if (dma && dma->getDevice())
+        {
+            b.run(label("read_dma"), -1, words, len, [&]
+            {
+                dma->wait(dma->copy(sram, src, len));
+            });
+            b.run(label("write_dma"), -1, words, len, [&]
+            {
+                dma->wait(dma->copy(dst, sram, len));
+            });
+            b.run(label("copy_dma"), -1, words, len * 2, [&]
+            {
+                dma->wait(dma->copy(dst, src, len));
+            });
+            /// 16分割して続けて積んだ場合。copy_dma との差が1要求あたりの手間になる
+            b.run(label("copy_dma_x16"), -1, words, len * 2, [&]
+            {
+                size_t part = (len >> 4) & ~3u;
+                for (size_t o = 0; o + part <= len && part; o += part)
+                {
+                    dma->copy((uint8_t*)dst + o, (const uint8_t*)src + o, part);
+                }
+                dma->wait();
+            });
+        }
+
+        arena.free(src);
+        arena.free(dst);
+    }
+
+    /// SDRAM_Arena の確保・解放の性能と断片化。pixels 列は確保と解放の回数。
+    /// 64B〜64KiB の領域を最大32個保持しながら確保・解放を繰り返し、
+    /// 終了時(全て解放する前)の統計を返す
+    inline lgfx::sdram_arena_stats_t run_arena_suite(Benchmark& b, lgfx::SDRAM_Arena& arena)
+    {
+        static constexpr size_t slots = 32;
+        static constexpr uint32_t ops = 2048;
+        void* live[slots] = {};
+        uint32_t seed = 1;
+        auto next = [&]{ seed = seed * 1103515245u + 12345u; return seed >> 8; };
+        lgfx::sdram_arena_stats_t stats = {};
+
+        b.run("arena_alloc_free", -1, ops, 0, [&]
+        {
+            for (uint32_t i = 0; i < ops; ++i)
+            {
+                auto& p = live[next() % slots];
+                if (p)
+                {
+                    arena.free(p);
+                    p = nullptr;
+                }
+                else
+                {
+                    p = arena.alloc(64u << (next() % 11));
+                }
+            }
+        });
+        stats = arena.getStats();
+        for (auto& p : live) { arena.free(p); p = nullptr; }
+
+        lgfx::SDRAM_Pool pool;
+        if (pool.init(arena, 1024, slots))
+        {
+            b.run("pool_alloc_free", -1, ops, 0, [&]
+            {
+                for (uint32_t i = 0; i < ops; ++i)
+                {
+                    auto& p = live[next() % slots];
+                    if (p) { pool.free(p); p = nullptr; }
+                    else   { p = pool.alloc(); }
+                }
+            });
+            for (auto& p : live) { pool.free(p); p = nullptr; }
+            pool.release();
+        }
+
+        lgfx::SDRAM_FrameArena frame;
+        if (frame.init(arena, 256 * 1024))
+        {
+            b.run("frame_alloc", -1, ops, 0, [&]
+            {
+                frame.reset();
+                for (uint32_t i = 0; i < ops; ++i) { frame.alloc(next() % 128); }
+            });
+            frame.release();
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,356 @@
+#include "DMA2D_Engine.hpp"
+#include <stm32f7xx_hal_rcc.h>
+#include <string.h>
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        static uint32_t dma2d_read(const uint8_t* p, dma2d_format_t format)
+        {
+            uint32_t a, r, g, b;
+            switch (format)
+            {
+            case dma2d_argb8888:
+                return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+
+            case dma2d_rgb888:
+                return p[0] | p[1] << 8 | p[2] << 16 | 0xFF000000u;
+
+            case dma2d_rgb565:
+            {
+                uint32_t v = p[0] | p[1] << 8;
+                r = (v >> 11) & 0x1F; r = (r << 3) | (r >> 2);
+                g = (v >>  5) & 0x3F; g = (g << 2) | (g >> 4);
+                b =  v        & 0x1F; b = (b << 3) | (b >> 2);
+                return 0xFF000000u | r << 16 | g << 8 | b;
+            }
+
+            case dma2d_argb1555:
+            {
+                uint32_t v = p[0] | p[1] << 8;
+                a = (v & 0x8000) ? 0xFF : 0;
+                r = (v >> 10) & 0x1F; r = (r << 3) | (r >> 2);
+                g = (v >>  5) & 0x1F; g = (g << 3) | (g >> 2);
+                b =  v        & 0x1F; b = (b << 3) | (b >> 2);
+                return a << 24 | r << 16 | g << 8 | b;
+            }
+
+            default: // dma2d_argb4444
+            {
+                uint32_t v = p[0] | p[1] << 8;
+                a = ((v >> 12) & 0xF) * 0x11;
+                r = ((v >>  8) & 0xF) * 0x11;
+                g = ((v >>  4) & 0xF) * 0x11;
+                b = ( v        & 0xF) * 0x11;
+                return a << 24 | r << 16 | g << 8 | b;
+            }
+            }
+        }
+
+        static void dma2d_write(uint8_t* p, uint32_t argb, dma2d_format_t format)
+        {
+            uint32_t v;
+            switch (format)
+            {
+            case dma2d_argb8888:
+                p[3] = argb >> 24;
+                /* fall through */
+            case dma2d_rgb888:
+                p[0] = argb;
+                p[1] = argb >> 8;
+                p[2] = argb >> 16;
+                return;
+
+            case dma2d_rgb565:
+                v = (argb >> 8 & 0xF800) | (argb >> 5 & 0x07E0) | (argb >> 3 & 0x001F);
+                break;
+
+            case dma2d_argb1555:
+                v = (argb >> 16 & 0x8000) | (argb >> 9 & 0x7C00)
+                  | (argb >> 6 & 0x03E0) | (argb >> 3 & 0x001F);
+                break;
+
+            default: // dma2d_argb4444
+                v = (argb >> 16 & 0xF000) | (argb >> 12 & 0x0F00)
+                  | (argb >> 8 & 0x00F0) | (argb >> 4 & 0x000F);
+                break;
+            }
+            p[0] = v;
+            p[1] = v >> 8;
+        }
+
+        void DMA2D_Device_Soft::start(DMA2D_Engine* owner, const dma2d_desc_t& desc)
+        {
+            size_t dbytes = DMA2D_Engine::format_bytes(desc.dst_format);
+            size_t sbytes = DMA2D_Engine::format_bytes(desc.src_format);
+            size_t dpitch = (desc.width + desc.dst_offset) * dbytes;
+            size_t spitch = (desc.width + desc.src_offset) * sbytes;
+            auto dst = (uint8_t*)desc.dst;
+            auto src = (const uint8_t*)desc.src;
+            uint_fast16_t h = desc.height;
+            do {
+                switch (desc.mode)
+                {
+                case dma2d_desc_t::fill:
+                    for (size_t i = 0; i < desc.width; ++i)
+                    {
+                        memcpy(&dst[i * dbytes], &desc.color, dbytes);
+                    }
+                    break;
+
+                case dma2d_desc_t::copy:
+                    memcpy(dst, src, desc.width * dbytes);
+                    break;
+
+                case dma2d_desc_t::convert:
+                    for (size_t i = 0; i < desc.width; ++i)
+                    {
+                        dma2d_write(&dst[i * dbytes],
+                                    dma2d_read(&src[i * sbytes], desc.src_format),
+                                    desc.dst_format);
+                    }
+                    break;
+                }
+                dst += dpitch;
+                src += spitch;
+            } while (--h);
+            if (owner) { owner->complete(); }
+        }
+
+#if defined (DMA2D)
+        /// 完了割り込みとキューを取り合う間は割り込みを止める
+        struct dma2d_irq_lock_t
+        {
+            uint32_t primask = __get_PRIMASK();
+            dma2d_irq_lock_t(void) { __disable_irq(); }
+            ~dma2d_irq_lock_t(void) { __set_PRIMASK(primask); }
+        };
+
+        /// DMA2D は1つで、パネルごとの DMA2D_Engine が共有する
+        struct DMA2D_Device_HW : public IDMA2D_Device
+        {
+            void start(DMA2D_Engine* owner, const dma2d_desc_t& desc) override
+            {
+                /// 他のパネルの転送中は、その完了割り込みが済むまで待つ
+                while (_running) {}
+                _running = owner;
+
+                size_t dbytes = DMA2D_Engine::format_bytes(desc.dst_format);
+                _clean_invalidate(desc.dst, (desc.width + desc.dst_offset) * dbytes, desc.height);
+
+                uint32_t mode = 0;
+                if (desc.mode == dma2d_desc_t::fill)
+                {
+                    mode = DMA2D_CR_MODE;
+                    DMA2D->OCOLR = desc.color;
+                }
+                else
+                {
+                    if (desc.mode == dma2d_desc_t::convert)
+                    {
+                        mode = DMA2D_CR_MODE_0;
+                    }
+                    size_t sbytes = DMA2D_Engine::format_bytes(desc.src_format);
+                    _clean_invalidate(desc.src, (desc.width + desc.src_offset) * sbytes, desc.height);
+                    DMA2D->FGMAR   = (uint32_t)desc.src;
+                    DMA2D->FGOR    = desc.src_offset;
+                    DMA2D->FGPFCCR = desc.src_format;
+                }
+                DMA2D->OPFCCR = desc.dst_format;
+                DMA2D->OMAR   = (uint32_t)desc.dst;
+                DMA2D->OOR    = desc.dst_offset;
+                DMA2D->NLR    = (uint32_t)desc.width << 16 | desc.height;
+                DMA2D->IFCR   = 0x3F;
+                DMA2D->CR     = mode | DMA2D_CR_TCIE | DMA2D_CR_TEIE | DMA2D_CR_CEIE | DMA2D_CR_START;
+            }
+
+            /// DMA2D_IRQHandler から呼ぶ。転送の失敗 (TEIF・CEIF) も完了として次へ進める
+            static void irq(void)
+            {
+                uint32_t isr = DMA2D->ISR;
+                DMA2D->IFCR = isr & 0x3F;
+                if (!(isr & (DMA2D_ISR_TCIF | DMA2D_ISR_TEIF | DMA2D_ISR_CEIF))) return;
+                auto owner = _running;
+                _running = nullptr;
+                if (owner) { owner->complete(); }
+            }
+
+        private:
+            static DMA2D_Engine* volatile _running;
+
+            static void _clean_invalidate(const void* addr, size_t pitch, size_t lines)
+            {
+#if defined (__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+                if (SCB->CCR & SCB_CCR_DC_Msk)
+                {
+                    uint32_t start = (uint32_t)addr & ~31u;
+                    uint32_t end   = ((uint32_t)addr + pitch * lines + 31) & ~31u;
+                    SCB_CleanInvalidateDCache_by_Addr((uint32_t*)start, end - start);
+                }
+#endif
+            }
+        };
+        DMA2D_Engine* volatile DMA2D_Device_HW::_running = nullptr;
+
+        void dma2d_irq_handler(void)
+        {
+            DMA2D_Device_HW::irq();
+        }
+#else
+        struct dma2d_irq_lock_t
+        {
+            ~dma2d_irq_lock_t(void) {}
+        };
+#endif
+
+        bool DMA2D_Engine::init(void)
+        {
+            if (_device == nullptr)
+            {
+#if defined (DMA2D)
+                static DMA2D_Device_HW hw_device;
+                __HAL_RCC_DMA2D_CLK_ENABLE();
+                NVIC_SetPriority(DMA2D_IRQn, 5);
+                NVIC_EnableIRQ(DMA2D_IRQn);
+                _device = &hw_device;
+#else
+                static DMA2D_Device_Soft soft_device;
+                _device = &soft_device;
+#endif
+            }
+            return true;
+        }
+
+        bool DMA2D_Engine::_accept(uint_fast16_t w, uint_fast16_t h)
+        {
+            if (_device == nullptr || !w || !h || w >= 0x4000)
+            {
+                return false;
+            }
+            if (w * h < _threshold)
+            {
+                ++_stats.cpu_fallbacks;
+                return false;
+            }
+            return true;
+        }
+
+        void DMA2D_Engine::_run(const dma2d_desc_t& desc, bool async)
+        {
+            /// 同期の要求も先に積まれた要求の後に並べ、完了を待つ
+            if (_count == queue_size)
+            {
+                ++_stats.queue_full;
+                while (_count == queue_size) { _poll(); }
+            }
+            bool idle;
+            {
+                dma2d_irq_lock_t lock;
+                _queue[(_head + _count) % queue_size] = desc;
+                ++_count;
+                if (async) { ++_stats.async_jobs; }
+                idle = !_active;
+                _active = true;
+            }
+            /// 実行中でなければ完了割り込みは来ないので、_head はここでしか変わらない。
+            /// 他のパネルの完了を待つことがあるため、割り込みを止めたまま開始しない
+            if (idle)
+            {
+                _start(_queue[_head]);
+            }
+            if (!async)
+            {
+                wait();
+            }
+        }
+
+        void DMA2D_Engine::_start(const dma2d_desc_t& desc)
+        {
+            ++_stats.jobs;
+            _stats.bytes += desc.width * desc.height
+                          * format_bytes(desc.dst_format);
+            _device->start(this, desc);
+        }
+
+        void DMA2D_Engine::complete(void)
+        {
+            if (!_count) return;
+            _head = (_head + 1) % queue_size;
+            --_count;
+            /// 開始した要求の内容はレジスタへ写すので、次をすぐ開始してよい
+            if (_count)
+            {
+                _start(_queue[_head]);
+            }
+            else
+            {
+                _active = false;
+            }
+        }
+
+        bool DMA2D_Engine::fill(void* dst, uint32_t dst_pitch,
+                                uint_fast16_t w, uint_fast16_t h,
+                                uint32_t color, dma2d_format_t format, bool async)
+        {
+            uint_fast8_t bytes = format_bytes(format);
+            if (dst_pitch % bytes || !_accept(w, h))
+            {
+                return false;
+            }
+            dma2d_desc_t desc = {};
+            desc.mode       = dma2d_desc_t::fill;
+            desc.src_format = format;
+            desc.dst_format = format;
+            desc.color      = color;
+            desc.dst        = dst;
+            desc.width      = w;
+            desc.height     = h;
+            desc.dst_offset = dst_pitch / bytes - w;
+            _run(desc, async);
+            return true;
+        }
+
+        bool DMA2D_Engine::copy(void* dst, uint32_t dst_pitch,
+                                const void* src, uint32_t src_pitch,
+                                uint_fast16_t w, uint_fast16_t h,
+                                dma2d_format_t format, bool async)
+        {
+            return convert(dst, dst_pitch, format, src, src_pitch, format, w, h, async);
+        }
+
+        bool DMA2D_Engine::convert(void* dst, uint32_t dst_pitch, dma2d_format_t dst_format,
+                                   const void* src, uint32_t src_pitch, dma2d_format_t src_format,
+                                   uint_fast16_t w, uint_fast16_t h, bool async)
+        {
+            uint_fast8_t dbytes = format_bytes(dst_format);
+            uint_fast8_t sbytes = format_bytes(src_format);
+            if (dst_pitch % dbytes || src_pitch % sbytes || !_accept(w, h))
+            {
+                return false;
+            }
+            dma2d_desc_t desc = {};
+            desc.mode       = (dst_format == src_format)
+                            ? dma2d_desc_t::copy
+                            : dma2d_desc_t::convert;
+            desc.src_format = src_format;
+            desc.dst_format = dst_format;
+            desc.src        = src;
+            desc.dst        = dst;
+            desc.width      = w;
+            desc.height     = h;
+            desc.src_offset = src_pitch / sbytes - w;
+            desc.dst_offset = dst_pitch / dbytes - w;
+            _run(desc, async);
+            return true;
+        }
+    }
+}
+
+#if defined (DMA2D) && !defined (DMA2D_NO_IRQHANDLER)
+/// DMA2D の転送完了割り込み。NVIC の設定は DMA2D_Engine::init() で行う
+extern "C" void DMA2D_IRQHandler(void)
+{
+    lgfx::dma2d_irq_handler();
+}
+#endif
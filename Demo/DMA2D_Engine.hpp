@@ -0,0 +1,133 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        /// DMA2D の OPFCCR/FGPFCCR と同じ値
+        enum dma2d_format_t : uint8_t
+        {
+            dma2d_argb8888 = 0,
+            dma2d_rgb888   = 1,
+            dma2d_rgb565   = 2,
+            dma2d_argb1555 = 3,
+            dma2d_argb4444 = 4,
+        };
+
+        struct dma2d_desc_t
+        {
+            enum mode_t : uint8_t
+            {
+                fill,    // register to memory
+                copy,    // memory to memory
+                convert, // memory to memory with PFC
+            };
+
+            mode_t mode;
+            dma2d_format_t src_format;
+            dma2d_format_t dst_format;
+            uint32_t color;
+            const void* src;
+            void* dst;
+            uint16_t width;
+            uint16_t height;
+            uint16_t src_offset; // 行末から次の行頭までの画素数 (FGOR)
+            uint16_t dst_offset; // 同上 (OOR)
+        };
+
+        struct dma2d_stats_t
+        {
+            uint32_t jobs;
+            uint32_t bytes;
+            uint32_t cpu_fallbacks;
+            uint32_t async_jobs;   // jobs のうち完了を待たずに戻ったもの
+            uint32_t queue_full;   // キューの空きを待った回数
+        };
+
+        class DMA2D_Engine;
+
+        struct IDMA2D_Device
+        {
+            virtual ~IDMA2D_Device(void) = default;
+            /// 転送を開始する。完了したら owner->complete() を呼ぶ (割り込みから呼んでよい)
+            virtual void start(DMA2D_Engine* owner, const dma2d_desc_t& desc) = 0;
+            /// 割り込みを使わない実装は、ここで完了を調べて complete() を呼ぶ
+            virtual void poll(void) {}
+        };
+
+        /// DMA2Dの動作をCPUで再現する。ホスト上での検証用。start() の中で完了する (owner は nullptr でもよい)
+        struct DMA2D_Device_Soft : public IDMA2D_Device
+        {
+            void start(DMA2D_Engine* owner, const dma2d_desc_t& desc) override;
+        };
+
+        /// DMA2D の割り込み処理 (実機のみ)。DMA2D_NO_IRQHANDLER を定義した場合は、
+        /// アプリケーションの DMA2D_IRQHandler() から呼ぶ
+        void dma2d_irq_handler(void);
+
+        class DMA2D_Engine
+        {
+        public:
+            static constexpr uint8_t format_bytes(dma2d_format_t format)
+            {
+                return format == dma2d_argb8888 ? 4
+                     : format == dma2d_rgb888   ? 3
+                     : 2;
+            }
+
+            /// 未指定の場合、DMA2Dがあればハードウェア、なければソフトウェアを使う
+            void setDevice(IDMA2D_Device* device) { _device = device; }
+            IDMA2D_Device* getDevice(void) const { return _device; }
+
+            /// 完了を待たずに戻る要求を保持しておける数 (実行中のものを含む)
+            static constexpr size_t queue_size = 8;
+
+            /// これより画素数の少ない要求は false を返し、呼び出し側でCPU処理させる
+            void setThreshold(uint32_t pixels) { _threshold = pixels; }
+            uint32_t getThreshold(void) const { return _threshold; }
+
+            const dma2d_stats_t& getStats(void) const { return _stats; }
+            void resetStats(void) { _stats = dma2d_stats_t(); }
+
+            bool init(void);
+
+            /// async が true の場合はキューに積んで、完了を待たずに戻る。次の要求は完了割り込みで開始する。
+            /// その場合 src の内容は wait() するか busy() が false になるまで保持し、変更しないこと
+            bool fill(void* dst, uint32_t dst_pitch,
+                      uint_fast16_t w, uint_fast16_t h,
+                      uint32_t color, dma2d_format_t format, bool async = false);
+            bool copy(void* dst, uint32_t dst_pitch,
+                      const void* src, uint32_t src_pitch,
+                      uint_fast16_t w, uint_fast16_t h, dma2d_format_t format, bool async = false);
+            bool convert(void* dst, uint32_t dst_pitch, dma2d_format_t dst_format,
+                         const void* src, uint32_t src_pitch, dma2d_format_t src_format,
+                         uint_fast16_t w, uint_fast16_t h, bool async = false);
+
+            void wait(void) { while (_active) { _poll(); } }
+            /// 実行中・キューに残っている要求があれば true (状態を見るだけで、要求は進めない)
+            bool busy(void) const { return _active; }
+
+            /// デバイスの転送完了時に呼ぶ (割り込みから呼んでよい)
+            void complete(void);
+
+        private:
+            IDMA2D_Device* _device = nullptr;
+            uint32_t _threshold = 256;
+            dma2d_stats_t _stats = {};
+
+            /// 完了割り込みが _head (実行中の要求) 側から取り出し、_run() が末尾に積むリングバッファ
+            dma2d_desc_t _queue[queue_size];
+            volatile uint8_t _head = 0;
+            volatile uint8_t _count = 0;
+            volatile bool _active = false;
+
+            bool _accept(uint_fast16_t w, uint_fast16_t h);
+            void _run(const dma2d_desc_t& desc, bool async);
+            void _start(const dma2d_desc_t& desc);
+            void _poll(void) { if (_device) { _device->poll(); } }
+        };
+    }
+}
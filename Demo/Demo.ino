@@ -1,6 +1,19 @@
 #include "LGFX_LTDC_STM32F746G_DISCO.hpp"
+#include "GlyphCache.hpp"
+#include "Benchmark.hpp"
 
 static LGFX_LTDC_STM32F746G_DISCO tft;
+static LGFX_LTDC_STM32F746G_DISCO_Overlay overlay(tft, 0, 0, 160, 32);
+// 高さ2画面分の仮想画面に書き進め、表示位置だけを動かしてスクロールする
+static LGFX_LTDC_STM32F746G_DISCO_Overlay console(tft, 0, 0, 480, 272, 480, 272 * 2);
+// SDRAM_DMA の転送先にも使うので、D-cache の行 (32バイト) に揃える
+alignas(32) static uint16_t image_buf[128 * 128];
+// 描いた文字を SDRAM に保持して、次からは1文字1回の転送で描く
+static lgfx::GlyphCache glyphs;
+
+static void benchOut(const char* str) {
+  Serial.print(str);
+}
 
 #define LTDC_BLACK       0x0000      /*   0,   0,   0 */
 #define LTDC_NAVY        0x000F      /*   0,   0, 128 */
@@ -27,6 +40,8 @@ void setup(void) {
   Serial.println("LTDC Test!");
 
   tft.init();
+  // 文字サイズ5の Font0 (30x40) まで収まる大きさ
+  glyphs.init(tft, tft.arena(), 32, 40, 256);
 
   Serial.println(F("Benchmark                Time (microseconds)"));
   delay(10);
@@ -38,6 +53,14 @@ void setup(void) {
   Serial.println(testText());
   delay(3000);
 
+  // 1回目でグリフを載せ、2回目を計測する
+  testTextCached();
+  Serial.print(F("Text (glyph cache)       "));
+  Serial.println(testTextCached());
+  Serial.print(F("Glyph cache hit rate (%) "));
+  Serial.println(glyphs.getHitRate());
+  delay(3000);
+
   Serial.print(F("Lines                    "));
   Serial.println(testLines(LTDC_CYAN));
   delay(500);
@@ -77,6 +100,71 @@ void setup(void) {
   Serial.println(testFilledRoundRects());
   delay(500);
 
+  for(uint8_t rotation=0; rotation<8; rotation++) {
+    Serial.print(F("pushImage  rotation "));
+    Serial.print(rotation);
+    Serial.print(F("    "));
+    Serial.println(testPushImage(rotation));
+    Serial.print(F("writePixels rotation "));
+    Serial.print(rotation);
+    Serial.print(F("   "));
+    Serial.println(testWritePixels(rotation));
+    Serial.print(F("readRect   rotation "));
+    Serial.print(rotation);
+    Serial.print(F("    "));
+    Serial.println(testReadRect(rotation));
+  }
+  tft.setRotation(0);
+  delay(500);
+
+  overlay.init();
+  Serial.print(F("Overlay move             "));
+  Serial.println(testOverlay());
+  delay(500);
+
+  Serial.print(F("Scroll (virtual surface) "));
+  Serial.println(testScroll());
+  delay(500);
+
+  Serial.print(F("Sprite in SDRAM          "));
+  Serial.println(testSprite());
+  delay(500);
+
+  // 各項目を繰り返し計測し、CSVで出力する
+  Serial.println(F("Benchmark (CSV)"));
+  {
+    bench::Benchmark b(benchOut, bench::Benchmark::format_csv, 16);
+    b.begin();
+    bench::run_standard_suite(b, tft, image_buf);
+    bench::run_span_suite(b, tft);
+    bench::run_line_suite(b, tft);
+    bench::run_alpha_suite(b, tft);
+    bench::run_sprite_suite(b, tft, tft.arena());
+    bench::run_zoom_suite(b, tft, tft.getPanelLTDC(), tft.arena());
+#if defined (LGFX_LTDC_FIXED_PANEL)
+    bench::run_panel_suite(b, tft, tft.getPanelLTDC(), "panel_t");
+#else
+    bench::run_panel_suite(b, tft, tft.getPanelLTDC(), "panel");
+#endif
+    auto fill_buf = (uint8_t *)tft.arena().alloc(480 * 272 * 4 + 4);
+    if (fill_buf) {
+      bench::run_scroll_suite(b, tft, (uint16_t *)fill_buf);
+      bench::run_fill_suite(b, fill_buf);
+      tft.arena().free(fill_buf);
+    }
+    // フレームバッファ(バンク0)を表示したまま、バンクの組み合わせごとに計測する
+    bench::run_text_suite(b, tft, glyphs);
+    bench::run_bank_suite(b, tft.arena());
+    // SDRAM の転送速度を、表示中とレイヤーを止めてLTDCの読み出しがない状態で比べる。
+    // image_buf (内蔵SRAM) を相手側の領域に使う
+    bench::run_sdram_suite(b, tft.arena(), (uint32_t *)image_buf, sizeof(image_buf), &tft.sdram_dma(), true);
+    tft.getPanelLTDC().setLayerVisible(false);
+    tft.waitDisplay();
+    bench::run_sdram_suite(b, tft.arena(), (uint32_t *)image_buf, sizeof(image_buf), &tft.sdram_dma(), false);
+    tft.getPanelLTDC().setLayerVisible(true);
+    b.end();
+  }
+
   Serial.println(F("Done!"));
 
 }
@@ -131,6 +219,33 @@ unsigned long testText() {
   return micros() - start;
 }
 
+// testText() と同じ内容を GlyphCache で描く
+unsigned long testTextCached() {
+  tft.fillScreen(LTDC_BLACK);
+  unsigned long start = micros();
+  int32_t y = 0;
+  auto line = [&](const char* str, uint16_t color, uint8_t size) {
+    tft.setTextColor(color);
+    tft.setTextSize(size);
+    glyphs.drawString(str, 0, y);
+    y += tft.fontHeight();
+  };
+  line("Hello World!", LTDC_WHITE, 1);
+  line("1234.56", LTDC_YELLOW, 2);
+  line("DEADBEEF", LTDC_RED, 3);
+  y += tft.fontHeight();
+  line("Groop", LTDC_GREEN, 5);
+  line("I implore thee,", LTDC_GREEN, 2);
+  line("my foonting turlingdromes.", LTDC_GREEN, 1);
+  line("And hooptiously drangle me", LTDC_GREEN, 1);
+  line("with crinkly bindlewurdles,", LTDC_GREEN, 1);
+  line("Or I will rend thee", LTDC_GREEN, 1);
+  line("in the gobberwarts", LTDC_GREEN, 1);
+  line("with my blurglecruncheon,", LTDC_GREEN, 1);
+  line("see if I don't!", LTDC_GREEN, 1);
+  return micros() - start;
+}
+
 unsigned long testLines(uint16_t color) {
   unsigned long start, t;
   int           x1, y1, x2, y2,
@@ -346,3 +461,132 @@ unsigned long testFilledRoundRects() {
 
   return micros() - start;
 }
+
+
+unsigned long testPushImage(uint8_t rotation) {
+  unsigned long start;
+  int           i, w = 128, h = 128;
+
+  for(i=0; i<w*h; i++) image_buf[i] = i * 31;
+  tft.setRotation(rotation);
+  tft.fillScreen(LTDC_BLACK);
+  start = micros();
+  for(i=0; i<20; i++) {
+    tft.pushImage(i * 4, i * 2, w, h, (lgfx::swap565_t*)image_buf);
+  }
+
+  return micros() - start;
+}
+
+unsigned long testWritePixels(uint8_t rotation) {
+  unsigned long start;
+  int           i, w = 128, h = 128;
+
+  tft.setRotation(rotation);
+  tft.fillScreen(LTDC_BLACK);
+  start = micros();
+  tft.startWrite();
+  for(i=0; i<20; i++) {
+    tft.setAddrWindow(i * 4, i * 2, w, h);
+    tft.writePixels((lgfx::swap565_t*)image_buf, w * h);
+  }
+  tft.endWrite();
+
+  return micros() - start;
+}
+
+unsigned long testReadRect(uint8_t rotation) {
+  unsigned long start;
+  int           i, w = 128, h = 128;
+
+  tft.setRotation(rotation);
+  start = micros();
+  for(i=0; i<20; i++) {
+    tft.readRect(i * 4, i * 2, w, h, (lgfx::swap565_t*)image_buf);
+  }
+
+  return micros() - start;
+}
+
+unsigned long testOverlay() {
+  tft.fillScreen(LTDC_NAVY);
+  overlay.fillScreen(LTDC_BLACK);
+  overlay.drawRect(0, 0, overlay.width(), overlay.height(), LTDC_WHITE);
+  overlay.setTextColor(LTDC_YELLOW);
+  overlay.setTextSize(2);
+  overlay.drawString("Overlay", 8, 8);
+
+  // 背景を描き直さずにレイヤーの位置だけを動かす
+  auto& panel = overlay.getPanelLTDC();
+  unsigned long start = micros();
+  for(int i=0; i<=tft.height() - overlay.height(); i+=4) {
+    panel.moveLayer(i * (tft.width() - overlay.width()) / (tft.height() - overlay.height()), i);
+    panel.waitDisplay();
+  }
+  unsigned long t = micros() - start;
+
+  panel.setLayerAlpha(128);
+  delay(500);
+  panel.setLayerVisible(false);
+  return t;
+}
+
+unsigned long testScroll() {
+  // overlay と同じレイヤー1を使うので、ここで設定し直す
+  console.init();
+  auto& panel = console.getPanelLTDC();
+  tft.fillScreen(LTDC_NAVY);
+  console.fillScreen(LTDC_BLACK);
+  console.setTextColor(LTDC_GREEN);
+  console.setTextSize(2);
+  console.setCursor(0, 0);
+
+  // 画面の下端に達したら、仮想画面上の表示開始位置を下げる (画素の複写はしない)
+  unsigned long start = micros();
+  for (int line = 0; console.getCursorY() + console.fontHeight() <= console.height(); ++line) {
+    console.print("line ");
+    console.println(line);
+    int bottom = console.getCursorY();
+    if (bottom > (int)panel.getViewHeight()) {
+      panel.setScroll(0, bottom - panel.getViewHeight());
+      panel.waitDisplay();
+    }
+  }
+  unsigned long t = micros() - start;
+
+  delay(500);
+  panel.setLayerVisible(false);
+  return t;
+}
+
+unsigned long testSprite() {
+  // 内蔵SRAMに収まらない大きさのスプライトをSDRAMに置く
+  static LGFX_Sprite sprite(&tft);
+  if (!lgfx::createSpriteInArena(sprite, tft.arena(), 320, 200)) {
+    return 0;
+  }
+  sprite.fillScreen(LTDC_DARKGREEN);
+  for (int i = 0; i < 200; i += 10) {
+    sprite.drawLine(0, i, 319, 199 - i, LTDC_YELLOW);
+  }
+  sprite.setTextColor(LTDC_WHITE);
+  sprite.setTextSize(2);
+  sprite.drawString("Sprite in SDRAM", 8, 8);
+
+  tft.fillScreen(LTDC_BLACK);
+  unsigned long start = micros();
+  for (int x = 0; x <= tft.width() - 320; x += 8) {
+    sprite.pushSprite(x, (tft.height() - 200) / 2);
+  }
+  unsigned long t = micros() - start;
+
+  auto stats = tft.arena().getStats();
+  Serial.print(F("(arena used "));
+  Serial.print(stats.used);
+  Serial.print(F(" / "));
+  Serial.print(stats.total);
+  Serial.print(F(" bytes) "));
+
+  lgfx::deleteSpriteInArena(sprite, tft.arena());
+  return t;
+}
@@ -0,0 +1,115 @@
+#include "DirtyRegion.hpp"
+#include <algorithm>
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        void DirtyRegion::init(uint_fast16_t width, uint_fast16_t height)
+        {
+            _width = width;
+            _height = height;
+            _tile_shift = 3;
+            while (((width  - 1) >> _tile_shift) >= max_cols
+                || ((height - 1) >> _tile_shift) >= max_rows)
+            {
+                ++_tile_shift;
+            }
+            clear();
+        }
+
+        void DirtyRegion::add(uint_fast16_t x, uint_fast16_t y,
+                              uint_fast16_t w, uint_fast16_t h)
+        {
+            if (!w || !h) return;
+            uint_fast8_t s = _tile_shift;
+            uint_fast8_t c0 = x >> s;
+            uint_fast8_t c1 = (x + w - 1) >> s;
+            uint_fast8_t r0 = y >> s;
+            uint_fast8_t r1 = (y + h - 1) >> s;
+            uint32_t mask = (c1 - c0 == 31) ? ~0u
+                          : ((2u << (c1 - c0)) - 1) << c0;
+            for (uint_fast8_t r = r0; r <= r1; ++r)
+            {
+                _rows[r] |= mask;
+            }
+            if (_top > r0) { _top = r0; }
+            if (_bottom < r1) { _bottom = r1; }
+        }
+
+        void DirtyRegion::clear(void)
+        {
+            if (!empty())
+            {
+                std::fill(&_rows[_top], &_rows[_bottom + 1], 0);
+            }
+            _top = max_rows;
+            _bottom = 0;
+        }
+
+        size_t DirtyRegion::getRects(dirty_rect_t* rects, size_t max) const
+        {
+            if (empty() || !max) return 0;
+
+            /// タイル単位で求めてから画素単位に直す
+            size_t count = 0;
+            size_t prev_begin = 0;
+            for (uint_fast8_t r = _top; r <= _bottom; ++r)
+            {
+                uint32_t m = _rows[r];
+                size_t cur_begin = count;
+                while (m)
+                {
+                    uint_fast8_t c0 = __builtin_ctz(m);
+                    uint32_t run = m + (1u << c0);
+                    uint_fast8_t c1 = run ? __builtin_ctz(run) : 32;
+                    m = (c1 == 32) ? 0 : (m & ~((1u << c1) - 1));
+
+                    size_t i = prev_begin;
+                    for (; i < cur_begin; ++i)
+                    {
+                        auto& rc = rects[i];
+                        if (rc.x == c0 && rc.w == c1 - c0 && rc.y + rc.h == r)
+                        {
+                            ++rc.h;
+                            break;
+                        }
+                    }
+                    if (i != cur_begin) continue;
+
+                    if (count < max)
+                    {
+                        rects[count++] = { (uint16_t)c0, (uint16_t)r, (uint16_t)(c1 - c0), 1 };
+                        continue;
+                    }
+                    auto& rc = rects[max - 1];
+                    uint_fast16_t x1 = std::max<uint_fast16_t>(rc.x + rc.w, c1);
+                    uint_fast16_t y1 = std::max<uint_fast16_t>(rc.y + rc.h, r + 1);
+                    rc.x = std::min<uint_fast16_t>(rc.x, c0);
+                    rc.y = std::min<uint_fast16_t>(rc.y, r);
+                    rc.w = x1 - rc.x;
+                    rc.h = y1 - rc.y;
+                }
+                /// この行で継続しなかった矩形は探索範囲から外す
+                for (size_t i = prev_begin; i < cur_begin; ++i)
+                {
+                    if (rects[i].y + rects[i].h != r + 1)
+                    {
+                        std::swap(rects[prev_begin++], rects[i]);
+                    }
+                }
+            }
+
+            uint_fast8_t s = _tile_shift;
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto& rc = rects[i];
+                rc.x <<= s;
+                rc.y <<= s;
+                rc.w = std::min<uint_fast16_t>(rc.w << s, _width  - rc.x);
+                rc.h = std::min<uint_fast16_t>(rc.h << s, _height - rc.y);
+            }
+            return count;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        struct dirty_rect_t
+        {
+            uint16_t x;
+            uint16_t y;
+            uint16_t w;
+            uint16_t h;
+        };
+
+        /// 変更された領域をタイル単位で記録する。座標はパネルの物理座標(回転前)
+        class DirtyRegion
+        {
+        public:
+            static constexpr size_t max_cols = 32;
+            static constexpr size_t max_rows = 64;
+
+            /// タイルの横の数が max_cols 以下になるようにタイルサイズを決める
+            void init(uint_fast16_t width, uint_fast16_t height);
+
+            void add(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h);
+            void add(uint_fast16_t x, uint_fast16_t y)
+            {
+                _rows[y >> _tile_shift] |= 1u << (x >> _tile_shift);
+                if (_top > (y >> _tile_shift)) { _top = y >> _tile_shift; }
+                if (_bottom < (y >> _tile_shift)) { _bottom = y >> _tile_shift; }
+            }
+            void addAll(void) { add(0, 0, _width, _height); }
+
+            bool empty(void) const { return _top > _bottom; }
+            void clear(void);
+
+            /// 縦に連続する同じ幅のタイル列をまとめた矩形を返す。
+            /// 矩形が max を超える場合は最後の要素に外接矩形として合成する
+            size_t getRects(dirty_rect_t* rects, size_t max) const;
+
+            uint_fast8_t getTileSize(void) const { return 1u << _tile_shift; }
+
+        private:
+            uint32_t _rows[max_rows] = {};
+            uint16_t _width = 0;
+            uint16_t _height = 0;
+            uint8_t _tile_shift = 4;
+            uint8_t _top = max_rows;
+            uint8_t _bottom = 0;
+        };
+    }
+}
@@ -0,0 +1,318 @@
+#include "GlyphCache.hpp"
+#include <string.h>
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        bool GlyphCache::init(LGFX_Device& gfx, SDRAM_Arena& arena, uint16_t slot_w, uint16_t slot_h, size_t slots)
+        {
+            release();
+            _depth = gfx.getColorDepth();
+            size_t bytes = (_depth & color_depth_t::bit_mask) >> 3;
+            if (!bytes || !slot_w || !slot_h || !slots)
+            {
+                return false;
+            }
+            if (slots > max_slots) { slots = max_slots; }
+            if (!_pool.init(arena, (size_t)slot_w * slot_h * bytes, slots))
+            {
+                return false;
+            }
+            uint16_t margin = slot_h >> 1;
+            _work = arena.alloc((size_t)(slot_w + 2 * margin) * (slot_h + 2 * margin) * bytes);
+            if (_work == nullptr)
+            {
+                _pool.release();
+                return false;
+            }
+            _gfx = &gfx;
+            _arena = &arena;
+            _margin = margin;
+            _slot_w = slot_w;
+            _slot_h = slot_h;
+            _capacity = slots;
+            clear();
+            resetStats();
+            return true;
+        }
+
+        void GlyphCache::release(void)
+        {
+            clear();
+            _pool.release();
+            if (_arena)
+            {
+                _arena->free(_work);
+            }
+            _work = nullptr;
+            _arena = nullptr;
+            _gfx = nullptr;
+            _capacity = 0;
+            _stats.capacity = 0;
+            _stats.bytes = 0;
+        }
+
+        void GlyphCache::clear(void)
+        {
+            for (uint16_t i = 0; i < _count; ++i)
+            {
+                _pool.free(_entries[i].pixels);
+            }
+            _count = 0;
+            _head = none;
+            _tail = none;
+            for (auto& b : _buckets) { b = none; }
+            _stats.entries = 0;
+        }
+
+        void GlyphCache::resetStats(void)
+        {
+            _stats = {};
+            _stats.entries  = _count;
+            _stats.capacity = _capacity;
+            _stats.bytes    = _pool.getBlockSize() * _pool.getCapacity();
+        }
+
+        int32_t GlyphCache::drawString(const char* str, int32_t x, int32_t y)
+        {
+            if (_gfx == nullptr) return 0;
+            bool utf8 = _gfx->getTextStyle().utf8;
+            int32_t left = x;
+            while (*str)
+            {
+                uint16_t code = (uint8_t)*str++;
+                if (utf8 && code >= 0xC0)
+                {
+                    /// 2〜4バイトの UTF-8 (16bit を超える文字は下位16bitになる)
+                    int n = code >= 0xF0 ? 3 : code >= 0xE0 ? 2 : 1;
+                    code &= 0x3F >> n;
+                    while (n-- && ((uint8_t)*str & 0xC0) == 0x80)
+                    {
+                        code = code << 6 | (*str++ & 0x3F);
+                    }
+                }
+                x += drawChar(code, x, y);
+            }
+            return x - left;
+        }
+
+        int32_t GlyphCache::drawChar(uint16_t code, int32_t x, int32_t y)
+        {
+            if (_gfx == nullptr) return 0;
+
+            auto depth = _gfx->getColorDepth();
+            if (depth != _depth)
+            {
+                clear();
+                _depth = depth;
+            }
+            size_t bytes = (depth & color_depth_t::bit_mask) >> 3;
+            if (!bytes || (size_t)_slot_w * _slot_h * bytes > _pool.getBlockSize())
+            {
+                ++_stats.direct;
+                return _gfx->drawChar(code, x, y);
+            }
+
+            auto& style = _gfx->getTextStyle();
+            entry_t key = {};
+            key.font   = _gfx->getFont();
+            key.fore   = style.fore_rgb888;
+            key.back   = style.back_rgb888;
+            key.size_x = style.size_x;
+            key.size_y = style.size_y;
+            key.code   = code;
+
+            uint16_t i = _find(key);
+            if (i != none)
+            {
+                ++_stats.hits;
+                _unlink(i);
+                _push_front(i);
+            }
+            else
+            {
+                ++_stats.misses;
+                i = _insert(key);
+                _render(_entries[i]);
+            }
+
+            auto& e = _entries[i];
+            if (e.direct)
+            {
+                ++_stats.direct;
+                return _gfx->drawChar(code, x, y);
+            }
+            _sprite.setBuffer(e.pixels, e.w, e.h, _depth);
+            if (e.fore == e.back)
+            {
+                _sprite.pushSprite(_gfx, x, y, e.key);
+            }
+            else
+            {
+                _sprite.pushSprite(_gfx, x, y);
+            }
+            return e.advance;
+        }
+
+        bool GlyphCache::_render(entry_t& e)
+        {
+            e.direct = true;
+            e.pixels = _pool.alloc();
+            if (e.pixels == nullptr)
+            {
+                return false;
+            }
+
+            /// 作業領域の (m, m) を原点として描き、送り幅とフォントの高さの枠の外に描かれた画素がないか調べる
+            int32_t m = _margin;
+            int32_t work_w = _slot_w + 2 * m;
+            int32_t work_h = _slot_h + 2 * m;
+            _sprite.setBuffer(_work, work_w, work_h, _depth);
+            _sprite.setFont(e.font);
+            _sprite.setTextSize(e.size_x, e.size_y);
+            auto p = (uint8_t*)_work;
+            size_t bytes = (_depth & color_depth_t::bit_mask) >> 3;
+            bool transparent = e.fore == e.back;
+            uint8_t fore_raw[4] = {};
+            uint8_t fill_raw[4] = {};
+            if (transparent)
+            {
+                /// 背景を描かない文字は、文字色と区別できる色で塗った上に描き、その色を透過して転送する
+                e.key = e.fore ^ 0x808080u;
+                _sprite.fillScreen(e.fore);
+                memcpy(fore_raw, p, bytes);
+                _sprite.fillScreen(e.key);
+                _sprite.setTextColor(e.fore);
+            }
+            else
+            {
+                _sprite.fillScreen(e.back);
+                _sprite.setTextColor(e.fore, e.back);
+            }
+            memcpy(fill_raw, p, bytes);
+
+            int32_t advance = _sprite.drawChar(e.code, m, m);
+            int32_t h = _sprite.fontHeight();
+            bool ok = advance > 0 && advance <= _slot_w && h <= _slot_h
+                   && (!transparent || memcmp(fore_raw, fill_raw, bytes));
+            for (int32_t y = 0; ok && y < work_h; ++y)
+            {
+                auto row = p + y * work_w * bytes;
+                bool in_row = y >= m && y < m + h;
+                for (int32_t x = 0; x < work_w; ++x)
+                {
+                    auto px = row + x * bytes;
+                    if (memcmp(px, fill_raw, bytes) == 0) continue;
+                    /// 枠の外の画素は drawChar でしか描けない。
+                    /// アンチエイリアスのあるフォントは中間色が透過色と混ざるのでキャッシュしない
+                    if (!in_row || x < m || x >= m + advance
+                     || (transparent && memcmp(px, fore_raw, bytes)))
+                    {
+                        ok = false;
+                        break;
+                    }
+                }
+            }
+            if (!ok)
+            {
+                _pool.free(e.pixels);
+                e.pixels = nullptr;
+                return false;
+            }
+
+            /// 枠の中を送り幅に詰めて写し、転送時の幅と合わせる
+            auto dst = (uint8_t*)e.pixels;
+            for (int32_t y = 0; y < h; ++y)
+            {
+                memcpy(dst + y * advance * bytes, p + ((y + m) * work_w + m) * bytes, advance * bytes);
+            }
+            e.w = advance;
+            e.h = h;
+            e.advance = advance;
+            e.direct = false;
+            return true;
+        }
+
+        uint32_t GlyphCache::_hash(const entry_t& e)
+        {
+            uint32_t sx, sy;
+            memcpy(&sx, &e.size_x, sizeof(sx));
+            memcpy(&sy, &e.size_y, sizeof(sy));
+            uint32_t h = (uint32_t)(uintptr_t)e.font;
+            h = (h ^ e.fore) * 0x01000193u;
+            h = (h ^ e.back) * 0x01000193u;
+            h = (h ^ sx ^ (sy << 1)) * 0x01000193u;
+            h = (h ^ e.code) * 0x01000193u;
+            return h ^ (h >> 16);
+        }
+
+        bool GlyphCache::_match(const entry_t& a, const entry_t& b)
+        {
+            return a.code == b.code && a.font == b.font
+                && a.fore == b.fore && a.back == b.back
+                && a.size_x == b.size_x && a.size_y == b.size_y;
+        }
+
+        uint16_t GlyphCache::_find(const entry_t& key) const
+        {
+            for (uint16_t i = _buckets[_hash(key) % bucket_count]; i != none; i = _entries[i].hnext)
+            {
+                if (_match(_entries[i], key)) return i;
+            }
+            return none;
+        }
+
+        uint16_t GlyphCache::_insert(const entry_t& key)
+        {
+            uint16_t i;
+            if (_count < _capacity)
+            {
+                i = _count++;
+                _stats.entries = _count;
+            }
+            else
+            {
+                /// 最も長く使っていないものを捨てる
+                i = _tail;
+                _unlink(i);
+                _unhash(i);
+                _pool.free(_entries[i].pixels);
+                ++_stats.evictions;
+            }
+            auto& e = _entries[i];
+            e = key;
+            auto& bucket = _buckets[_hash(key) % bucket_count];
+            e.hnext = bucket;
+            bucket = i;
+            _push_front(i);
+            return i;
+        }
+
+        void GlyphCache::_unlink(uint16_t index)
+        {
+            auto& e = _entries[index];
+            if (e.prev != none) { _entries[e.prev].next = e.next; } else { _head = e.next; }
+            if (e.next != none) { _entries[e.next].prev = e.prev; } else { _tail = e.prev; }
+        }
+
+        void GlyphCache::_push_front(uint16_t index)
+        {
+            auto& e = _entries[index];
+            e.prev = none;
+            e.next = _head;
+            if (_head != none) { _entries[_head].prev = index; } else { _tail = index; }
+            _head = index;
+        }
+
+        void GlyphCache::_unhash(uint16_t index)
+        {
+            auto* link = &_buckets[_hash(_entries[index]) % bucket_count];
+            while (*link != index)
+            {
+                link = &_entries[*link].hnext;
+            }
+            *link = _entries[index].hnext;
+        }
+    }
+}
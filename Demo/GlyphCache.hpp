@@ -0,0 +1,103 @@
+#pragma once
+
+#include <LovyanGFX.hpp>
+#include "SDRAM_Arena.hpp"
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        struct glyph_cache_stats_t
+        {
+            uint32_t hits;
+            uint32_t misses;
+            uint32_t evictions;
+            uint32_t direct;     // キャッシュできずに drawChar で描いた回数
+            uint32_t entries;    // 保持しているグリフの数
+            uint32_t capacity;
+            size_t bytes;        // グリフの画素に確保した SDRAM の大きさ
+        };
+
+        /// 描画した文字を表示と同じ画素形式で SDRAM に保持し、次からは1文字1回の転送で描く。
+        /// フォント・文字サイズ・文字色・背景色ごとに別のグリフとして扱い、一杯になると最も長く使っていないものを捨てる
+        class GlyphCache
+        {
+        public:
+            static constexpr size_t max_slots = 256;
+
+            /// slot_w x slot_h 画素のグリフを slots 個まで保持する領域と、描画用の作業領域を arena から確保する。
+            /// 画素形式は gfx の色深度に合わせ、色深度が変わると保持しているグリフを捨てる。
+            /// init() の時点より1画素のバイト数が大きくなった場合はキャッシュせずに描く
+            bool init(LGFX_Device& gfx, SDRAM_Arena& arena, uint16_t slot_w, uint16_t slot_h, size_t slots);
+            void release(void);
+            /// 保持しているグリフを全て捨てる (フォントのデータを差し替えた場合など)
+            void clear(void);
+
+            /// gfx の現在のフォント・文字サイズ・文字色で、(x, y) を左上として1行描く。
+            /// 戻り値は描いた幅。textdatum と改行は扱わない。
+            /// 送り幅とフォントの高さの枠からはみ出す文字 (左に張り出す・斜体など) はキャッシュせずに描く
+            int32_t drawString(const char* str, int32_t x, int32_t y);
+            /// 1文字描いて、送り幅を返す
+            int32_t drawChar(uint16_t code, int32_t x, int32_t y);
+
+            const glyph_cache_stats_t& getStats(void) const { return _stats; }
+            void resetStats(void);
+            /// hits / (hits + misses) を 0〜100 で返す
+            uint32_t getHitRate(void) const
+            {
+                uint32_t total = _stats.hits + _stats.misses;
+                return total ? (uint32_t)((uint64_t)_stats.hits * 100 / total) : 0;
+            }
+
+        private:
+            static constexpr uint16_t none = 0xFFFF;
+            static constexpr size_t bucket_count = 256;
+
+            struct entry_t
+            {
+                const IFont* font;
+                uint32_t fore;      // rgb888
+                uint32_t back;      // fore と同じ場合は背景を描かない
+                uint32_t key;       // 背景を描かない場合に透過させる色 (rgb888)
+                float size_x;
+                float size_y;
+                uint16_t code;
+                uint16_t w;
+                uint16_t h;
+                uint16_t advance;
+                uint16_t prev;      // LRU の前後 (prev 側が新しい)
+                uint16_t next;
+                uint16_t hnext;     // 同じハッシュの次
+                bool direct;        // キャッシュできないグリフ
+                void* pixels;
+            };
+
+            LGFX_Device* _gfx = nullptr;
+            SDRAM_Arena* _arena = nullptr;
+            SDRAM_Pool _pool;
+            /// グリフを描く作業領域。枠の外へのはみ出しを見つけるため、スロットの周りに _margin 画素の余白を持つ
+            void* _work = nullptr;
+            uint16_t _margin = 0;
+            LGFX_Sprite _sprite;
+            color_depth_t _depth = color_depth_t::rgb565_2Byte;
+            uint16_t _slot_w = 0;
+            uint16_t _slot_h = 0;
+            uint16_t _capacity = 0;
+            uint16_t _count = 0;
+            uint16_t _head = none;     // 最も新しい
+            uint16_t _tail = none;     // 最も古い
+            uint16_t _buckets[bucket_count];
+            entry_t _entries[max_slots];
+            glyph_cache_stats_t _stats = {};
+
+            static uint32_t _hash(const entry_t& e);
+            static bool _match(const entry_t& a, const entry_t& b);
+            uint16_t _find(const entry_t& key) const;
+            uint16_t _insert(const entry_t& key);
+            void _unlink(uint16_t index);
+            void _push_front(uint16_t index);
+            void _unhash(uint16_t index);
+            bool _render(entry_t& e);
+        };
+    }
+}
@@ -0,0 +1,185 @@
+#include "LGFX_LTDC_Device.hpp"
+#include <algorithm>
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        void LGFX_LTDC_Device::fillCircle(int32_t x, int32_t y, int32_t r)
+        {
+            if (_panel_ltdc == nullptr)
+            {
+                LGFX_Device::fillCircle(x, y, r);
+                return;
+            }
+            startWrite();
+            _panel_ltdc->beginSpans();
+            LGFX_Device::fillCircle(x, y, r);
+            _panel_ltdc->endSpans();
+            endWrite();
+        }
+
+        void LGFX_LTDC_Device::fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+        {
+            if (_panel_ltdc == nullptr)
+            {
+                LGFX_Device::fillTriangle(x0, y0, x1, y1, x2, y2);
+                return;
+            }
+            startWrite();
+            _panel_ltdc->beginSpans();
+            LGFX_Device::fillTriangle(x0, y0, x1, y1, x2, y2);
+            _panel_ltdc->endSpans();
+            endWrite();
+        }
+
+        void LGFX_LTDC_Device::fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r)
+        {
+            if (_panel_ltdc == nullptr)
+            {
+                LGFX_Device::fillRoundRect(x, y, w, h, r);
+                return;
+            }
+            startWrite();
+            _panel_ltdc->beginSpans();
+            LGFX_Device::fillRoundRect(x, y, w, h, r);
+            _panel_ltdc->endSpans();
+            endWrite();
+        }
+
+        bool LGFX_LTDC_Device::_in_clip(int32_t x, int32_t y)
+        {
+            int32_t cx, cy, cw, ch;
+            getClipRect(&cx, &cy, &cw, &ch);
+            return x >= cx && y >= cy && x < cx + cw && y < cy + ch;
+        }
+
+        void LGFX_LTDC_Device::drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+        {
+            /// 水平・垂直の線は LovyanGFX 側で1回の塗りつぶしになるのでそのまま渡す
+            if (_panel_ltdc == nullptr || x0 == x1 || y0 == y1
+             || !_in_clip(x0, y0) || !_in_clip(x1, y1))
+            {
+                LGFX_Device::drawLine(x0, y0, x1, y1);
+                return;
+            }
+            startWrite();
+            _panel_ltdc->drawLinePreclipped(x0, y0, x1, y1, getRawColor());
+            endWrite();
+        }
+
+        void LGFX_LTDC_Device::drawPolyline(const Panel_LTDC::point_t* points, uint32_t count)
+        {
+            if (!count) return;
+            bool inside = _panel_ltdc != nullptr;
+            for (uint32_t i = 0; inside && i < count; ++i)
+            {
+                inside = _in_clip(points[i].x, points[i].y);
+            }
+            startWrite();
+            if (inside)
+            {
+                _panel_ltdc->drawPolylinePreclipped(points, count, getRawColor());
+            }
+            else if (count == 1)
+            {
+                drawPixel(points[0].x, points[0].y);
+            }
+            else
+            {
+                for (uint32_t i = 1; i < count; ++i)
+                {
+                    drawLine(points[i - 1].x, points[i - 1].y, points[i].x, points[i].y);
+                }
+            }
+            endWrite();
+        }
+
+        bool LGFX_LTDC_Device::_clip_rect(int32_t& x, int32_t& y, int32_t& w, int32_t& h,
+                                          int32_t& src_x, int32_t& src_y)
+        {
+            int32_t cx, cy, cw, ch;
+            getClipRect(&cx, &cy, &cw, &ch);
+            if (x < cx) { src_x += cx - x; w -= cx - x; x = cx; }
+            if (y < cy) { src_y += cy - y; h -= cy - y; y = cy; }
+            if (w > cx + cw - x) { w = cx + cw - x; }
+            if (h > cy + ch - y) { h = cy + ch - y; }
+            return w > 0 && h > 0;
+        }
+
+        void LGFX_LTDC_Device::fillRectAlpha(int32_t x, int32_t y, int32_t w, int32_t h, uint8_t alpha, uint32_t rgb888)
+        {
+            if (_panel_ltdc == nullptr || !_panel_ltdc->canBlend())
+            {
+                LGFX_Device::fillRectAlpha(x, y, w, h, alpha, rgb888);
+                return;
+            }
+            if (w < 0) { x += w + 1; w = -w; }
+            if (h < 0) { y += h + 1; h = -h; }
+            int32_t sx = 0, sy = 0;
+            if (!_clip_rect(x, y, w, h, sx, sy)) return;
+            startWrite();
+            _panel_ltdc->fillRectAlphaPreclipped(x, y, w, h, rgb888, alpha);
+            endWrite();
+        }
+
+        void LGFX_LTDC_Device::pushAlphaImage(int32_t x, int32_t y, int32_t w, int32_t h, const argb8888_t* data)
+        {
+            if (_panel_ltdc == nullptr || !_panel_ltdc->canBlend())
+            {
+                LGFX_Device::pushAlphaImage(x, y, w, h, data);
+                return;
+            }
+            int32_t pitch = w;
+            int32_t sx = 0, sy = 0;
+            if (!_clip_rect(x, y, w, h, sx, sy)) return;
+            startWrite();
+            _panel_ltdc->blendImagePreclipped(x, y, w, h, (const uint32_t*)data + sx + sy * pitch, pitch);
+            endWrite();
+        }
+
+        void LGFX_LTDC_Device::pushAlphaMask(int32_t x, int32_t y, int32_t w, int32_t h, const uint8_t* alpha, uint32_t rgb888)
+        {
+            if (_panel_ltdc != nullptr && _panel_ltdc->canBlend())
+            {
+                int32_t pitch = w;
+                int32_t sx = 0, sy = 0;
+                if (!_clip_rect(x, y, w, h, sx, sy)) return;
+                startWrite();
+                _panel_ltdc->blendMaskPreclipped(x, y, w, h, alpha + sx + sy * pitch, pitch, rgb888);
+                endWrite();
+                return;
+            }
+            /// 対応しない形式では、1行ずつ ARGB8888 に変換して LovyanGFX で描く
+            static constexpr int32_t chunk = 64;
+            uint32_t buf[chunk];
+            rgb888 &= 0xFFFFFF;
+            startWrite();
+            for (int32_t j = 0; j < h; ++j)
+            {
+                for (int32_t i = 0; i < w; i += chunk)
+                {
+                    int32_t n = std::min(chunk, w - i);
+                    for (int32_t k = 0; k < n; ++k)
+                    {
+                        buf[k] = (uint32_t)alpha[i + k + j * w] << 24 | rgb888;
+                    }
+                    LGFX_Device::pushAlphaImage(x + i, y + j, n, 1, (const argb8888_t*)buf);
+                }
+            }
+            endWrite();
+        }
+
+        void LGFX_LTDC_Device::pushImageMasked(int32_t x, int32_t y, const void* data, const SpriteMask& mask)
+        {
+            if (_panel_ltdc == nullptr || !mask.isValid()) return;
+            int32_t w = mask.width();
+            int32_t h = mask.height();
+            int32_t sx = 0, sy = 0;
+            if (!_clip_rect(x, y, w, h, sx, sy)) return;
+            startWrite();
+            _panel_ltdc->writeImageMasked(x, y, w, h, data, mask, sx, sy);
+            endWrite();
+        }
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <LovyanGFX.hpp>
+#include "Panel_LTDC.hpp"
+#include "SpriteMask.hpp"
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        /// Panel_LTDC に描く LGFX_Device。塗りつぶした円・三角形・角丸矩形は LovyanGFX の実装が出す
+        /// 1行ずつの区間を Panel_LTDC に溜め、fillSpans() でまとめて書く (回転の解釈と書き込みの準備を省く)。
+        /// 斜めの線は Panel_LTDC::drawPolylinePreclipped() でフレームバッファに直接描く。
+        /// 半透明の矩形・画像は RGB565 であればフレームバッファ上で直接重ねる。
+        /// LGFX_Device& を通して呼んだ場合は LovyanGFX の実装で描かれる
+        class LGFX_LTDC_Device : public LGFX_Device
+        {
+        public:
+            void setPanel(Panel_LTDC* panel)
+            {
+                _panel_ltdc = panel;
+                LGFX_Device::setPanel(panel);
+            }
+
+            template <typename T>
+            void fillCircle(int32_t x, int32_t y, int32_t r, const T& color)
+            {
+                setColor(color);
+                fillCircle(x, y, r);
+            }
+            void fillCircle(int32_t x, int32_t y, int32_t r);
+
+            template <typename T>
+            void fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, const T& color)
+            {
+                setColor(color);
+                fillTriangle(x0, y0, x1, y1, x2, y2);
+            }
+            void fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+
+            template <typename T>
+            void fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, const T& color)
+            {
+                setColor(color);
+                fillRoundRect(x, y, w, h, r);
+            }
+            void fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r);
+
+            /// 両端がクリップ範囲内の斜めの線はパネルで描く。それ以外は LovyanGFX の実装で描く
+            template <typename T>
+            void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, const T& color)
+            {
+                setColor(color);
+                drawLine(x0, y0, x1, y1);
+            }
+            void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+
+            /// points[0] から順に count 個の頂点を結ぶ (グラフ・ワイヤーフレーム用)。
+            /// 全ての頂点がクリップ範囲内であれば1回の呼び出しでパネルに渡す
+            template <typename T>
+            void drawPolyline(const Panel_LTDC::point_t* points, uint32_t count, const T& color)
+            {
+                setColor(color);
+                drawPolyline(points, count);
+            }
+            void drawPolyline(const Panel_LTDC::point_t* points, uint32_t count);
+
+            /// 以下は RGB565 の場合、Panel_LTDC がフレームバッファ上で直接重ねる。
+            /// それ以外の色深度では LovyanGFX の実装 (readRect で読み出して書き戻す) を使う。alpha は 5bit に丸める
+            template <typename T>
+            void fillRectAlpha(int32_t x, int32_t y, int32_t w, int32_t h, uint8_t alpha, const T& color)
+            {
+                fillRectAlpha(x, y, w, h, alpha, convert_to_rgb888(color));
+            }
+            void fillRectAlpha(int32_t x, int32_t y, int32_t w, int32_t h, uint8_t alpha, uint32_t rgb888);
+
+            void pushAlphaImage(int32_t x, int32_t y, int32_t w, int32_t h, const argb8888_t* data);
+
+            /// 8bit の alpha の配列 (w*h) をマスクとして color を重ねる
+            template <typename T>
+            void pushAlphaMask(int32_t x, int32_t y, int32_t w, int32_t h, const uint8_t* alpha, const T& color)
+            {
+                pushAlphaMask(x, y, w, h, alpha, convert_to_rgb888(color));
+            }
+            void pushAlphaMask(int32_t x, int32_t y, int32_t w, int32_t h, const uint8_t* alpha, uint32_t rgb888);
+
+            /// 透過色を持つ画像を、mask (SpriteMask::build() で作った区間の表) の区間だけ描く。
+            /// 透過する部分は比較せずに飛ばす。data は mask を作った画像で、表示と同じ画素形式であること
+            void pushImageMasked(int32_t x, int32_t y, const void* data, const SpriteMask& mask);
+
+        protected:
+            Panel_LTDC* _panel_ltdc = nullptr;
+
+            bool _in_clip(int32_t x, int32_t y);
+            /// クリップ範囲に切り詰め、切り詰めた分だけ src_x・src_y を進める。何も残らない場合は false
+            bool _clip_rect(int32_t& x, int32_t& y, int32_t& w, int32_t& h, int32_t& src_x, int32_t& src_y);
+        };
+    }
+}
@@ -5,18 +5,59 @@
 #define LGFX_USE_V1
 #include <LovyanGFX.hpp>
 #include "Panel_LTDC.hpp"
-
-class LGFX_LTDC_STM32F746G_DISCO: public lgfx::LGFX_Device
+#include "Panel_LTDC_T.hpp"
+#include "LGFX_LTDC_Device.hpp"
+#include "SDRAM_Arena.hpp"
+#include "SDRAM_DMA.hpp"
+#include "SDRAM_Sprite.hpp"
+
+// 描画先の仮想画面の大きさ。480x272 より大きくすると setScroll() で表示する位置を動かせる。
+// フレームバッファ1枚(幅x高さx4 bytes)が SDRAM の1バンク(2MiB)に収まる大きさにすること
+#if !defined (LGFX_LTDC_VIRTUAL_WIDTH)
+#define LGFX_LTDC_VIRTUAL_WIDTH 480
+#endif
+#if !defined (LGFX_LTDC_VIRTUAL_HEIGHT)
+#define LGFX_LTDC_VIRTUAL_HEIGHT 272
+#endif
+
+class LGFX_LTDC_STM32F746G_DISCO: public lgfx::LGFX_LTDC_Device
 {
+    // LGFX_LTDC_FIXED_PANEL を定義すると、大きさと RGB565 をコンパイル時に固定したパネルを使う。
+    // setColorDepth() で色深度を変えられない代わりに、1画素・小さな矩形・区間の書き込みが速くなる
+#if defined (LGFX_LTDC_FIXED_PANEL)
+    lgfx::Panel_LTDC_T<LGFX_LTDC_VIRTUAL_WIDTH, LGFX_LTDC_VIRTUAL_HEIGHT> _panel_instance;
+#else
     lgfx::Panel_LTDC _panel_instance;
+#endif
+    lgfx::SDRAM_Arena _arena;
+    lgfx::SDRAM_DMA _sdram_dma;
 
     public:
+    static constexpr size_t sdram_bank_size = SDRAM_DEVICE_SIZE / 4;
+
     LGFX_LTDC_STM32F746G_DISCO()
     {
         BSP_SDRAM_Init();
+        _arena.init((void *)SDRAM_DEVICE_ADDR, SDRAM_DEVICE_SIZE);
+        // MT48LC4M32B2 は16bit幅・列8bit・行12bitで使うので、アドレスの bit22:21 が内部バンクになる
+        _arena.setBankSize(sdram_bank_size);
+        _sdram_dma.setClock([]() -> uint32_t { return lgfx::micros(); });
+        _sdram_dma.init();
 
         _init_gpios();
-        _panel_instance.setFrameBuffer((uint8_t *)SDRAM_DEVICE_ADDR);
+        // 32bit色でも収まるよう 仮想画面の幅x高さx4 bytes を確保する。
+        // LTDC の読み出しと CPU/DMA2D の書き込みが同じバンクの別の行に当たるとプリチャージが増えるので、
+        // フレームバッファはバンク0、バックバッファはバンク1 に置き、それ以外の確保はバンク2・3を優先する
+        static constexpr size_t fb_size = LGFX_LTDC_VIRTUAL_WIDTH * LGFX_LTDC_VIRTUAL_HEIGHT * 4;
+        auto framebuffer = (uint8_t *)_arena.allocInBanks(fb_size, 1 << 0);
+#if defined (LGFX_LTDC_DOUBLE_BUFFER)
+        _panel_instance.setFrameBuffer(framebuffer,
+                                       (uint8_t *)_arena.allocInBanks(fb_size, 1 << 1));
+        _panel_instance.setCopyForward(true);
+#else
+        _panel_instance.setFrameBuffer(framebuffer);
+#endif
+        _arena.setDefaultBanks(0b1100);
 
         {
             lgfx::Panel_LTDC::panel_timing_t panel_cfg = {
@@ -36,14 +77,24 @@ class LGFX_LTDC_STM32F746G_DISCO: public lgfx::LGFX_Device
             _panel_instance.setPanelTiming(panel_cfg);
 
             auto cfg = _panel_instance.config();
-            cfg.memory_width  = panel_cfg.h.active;
-            cfg.memory_height = panel_cfg.v.active;
+            cfg.memory_width  = LGFX_LTDC_VIRTUAL_WIDTH;
+            cfg.memory_height = LGFX_LTDC_VIRTUAL_HEIGHT;
             _panel_instance.config(cfg);
         }
 
         setPanel(&_panel_instance);
     }
 
+    lgfx::Panel_LTDC& getPanelLTDC(void) { return _panel_instance; }
+
+    /// フレームバッファを除いた SDRAM の残り。スプライトやキャッシュはここから確保する。
+    /// alloc() はフレームバッファと別のバンク(2・3)を優先する
+    lgfx::SDRAM_Arena& arena(void) { return _arena; }
+
+    /// SDRAM との間の転送を DMA2_Stream0 で行う。copy() は完了を待たずに戻るので、
+    /// 素材の読み込みと描画を並行させられる
+    lgfx::SDRAM_DMA& sdram_dma(void) { return _sdram_dma; }
+
     private:
     void _init_gpios()
     {
@@ -108,4 +159,35 @@ class LGFX_LTDC_STM32F746G_DISCO: public lgfx::LGFX_Device
         pinMode(PK3, OUTPUT);
         digitalWrite(PK3, HIGH);
     }
-};
\ No newline at end of file
+};
+
+/// レイヤー1に重ねて表示するオーバーレイ。カーソルやステータスバーなど、
+/// 背景(レイヤー0)を描き直さずに更新したいものを描く。init() は base の init() の後に呼ぶ。
+/// virtual_w, virtual_h を指定すると、その大きさに描画して w x h の範囲を setScroll() で選んで表示する
+class LGFX_LTDC_STM32F746G_DISCO_Overlay: public lgfx::LGFX_LTDC_Device
+{
+    lgfx::Panel_LTDC _panel_instance;
+
+    public:
+    LGFX_LTDC_STM32F746G_DISCO_Overlay(LGFX_LTDC_STM32F746G_DISCO& base,
+                                       uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                                       uint16_t virtual_w = 0, uint16_t virtual_h = 0)
+    {
+        if (virtual_w < w) { virtual_w = w; }
+        if (virtual_h < h) { virtual_h = h; }
+        _panel_instance.setFrameBuffer((uint8_t *)base.arena().alloc(virtual_w * virtual_h * 4));
+        _panel_instance.setBaseLayer(&base.getPanelLTDC(), 1);
+        _panel_instance.setLayerWindow(x, y, w, h);
+        // 黒を透過色とする
+        _panel_instance.setColorKey(0x000000);
+
+        auto cfg = _panel_instance.config();
+        cfg.memory_width  = virtual_w;
+        cfg.memory_height = virtual_h;
+        _panel_instance.config(cfg);
+
+        setPanel(&_panel_instance);
+    }
+
+    lgfx::Panel_LTDC& getPanelLTDC(void) { return _panel_instance; }
+};
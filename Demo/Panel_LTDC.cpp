@@ -1,57 +1,133 @@
 #include "Panel_LTDC.hpp"
+#include "pixel_kernels.hpp"
+#include "SpriteMask.hpp"
 #include <stm32f7xx_hal_rcc.h>
 #include <algorithm>
+#include <stdlib.h>
 
 namespace lgfx
 {
     inline namespace v1
     {
-        static void memset_multi(uint8_t* buf,
-                                    uint32_t c, size_t size, size_t length)
+        /// 塗りつぶし・転送では画素のバイト数だけが意味を持つ。8bitはDMA2Dで扱わない
+        static int dma2d_format_from_bits(uint_fast8_t bits)
         {
-            if (size == 1 || ((c & 0xFF) == ((c >> 8) & 0xFF)
-                && (size == 2 || ((c & 0xFF) == ((c >> 16) & 0xFF)))))
+            return bits == 32 ? dma2d_argb8888
+                 : bits == 24 ? dma2d_rgb888
+                 : bits == 16 ? dma2d_rgb565
+                 : -1;
+        }
+
+        /// DMA2D が書いた領域を CPU で読む場合、転送中に CPU が先読みしたキャッシュの行を完了後に捨てる。
+        /// 捨てる行に他のデータが載らないよう、キャッシュが有効な間は行 (32バイト) に揃った領域に限る
+        static bool dcache_line_aligned(const void* addr, size_t size)
+        {
+#if defined (__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+            if (SCB->CCR & SCB_CCR_DC_Msk)
             {
-                memset(buf, c, size * length);
-                return;
+                return !(((uintptr_t)addr | size) & 31);
             }
+#endif
+            return true;
+        }
 
-            size_t l = length;
-            if (l & ~0xF)
+        static void dcache_invalidate(void* addr, size_t size)
+        {
+#if defined (__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+            if (SCB->CCR & SCB_CCR_DC_Msk)
             {
-                while ((l >>= 1) & ~0xF);
-                ++l;
+                SCB_InvalidateDCache_by_Addr((uint32_t*)addr, size);
             }
-            size_t len = l * size;
-            length = (length * size) - len;
-            uint8_t* dst = buf;
-            if (size == 2) {
-                do { // 2byte speed tweak
-                    *(uint16_t*)dst = c;
-                    dst += 2;
-                } while (--l);
-            } else {
-                do {
-                    size_t i = 0;
-                    do {
-                        *dst++ = *(((uint8_t*)&c) + i);
-                    } while (++i != size);
-                } while (--l);
+#endif
+        }
+
+        static void store_pixel(uint8_t* dst, uint32_t rawcolor, uint_fast8_t bytes)
+        {
+            switch (bytes)
+            {
+            case 1:  *dst = rawcolor; break;
+            case 2:  *(uint16_t*)dst = rawcolor; break;
+            case 3:  dst[0] = rawcolor; dst[1] = rawcolor >> 8; dst[2] = rawcolor >> 16; break;
+            default: *(uint32_t*)dst = rawcolor; break;
             }
-            if (!length) return;
-            while (length > len) {
-                memcpy(dst, buf, len);
-                dst += len;
-                length -= len;
-                len <<= 1;
+        }
+
+        /// L8/AL44 用の既定のCLUTを作る
+        static size_t make_default_clut(uint32_t* clut, uint32_t format, color_depth_t depth)
+        {
+            if (format == LTDC_PIXEL_FORMAT_AL44)
+            {
+                for (uint32_t i = 0; i < 16; ++i)
+                {
+                    clut[i] = i * 0x111111u;
+                }
+                return 16;
             }
-            if (length) {
-                memcpy(dst, buf, length);
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                if (depth == color_depth_t::rgb332_1Byte)
+                {
+                    uint32_t r = (i >> 5) * 0x49 >> 1;
+                    uint32_t g = ((i >> 2) & 7) * 0x49 >> 1;
+                    uint32_t b = (i & 3) * 0x55;
+                    clut[i] = r << 16 | g << 8 | b;
+                }
+                else
+                {
+                    clut[i] = i * 0x010101u;
+                }
+            }
+            return 256;
+        }
+
+        /// DMA2Dのピクセルフォーマット変換で扱えるのはリトルエンディアンの形式のみ
+        static int dma2d_format_from_depth(color_depth_t depth)
+        {
+            switch (depth)
+            {
+            case color_depth_t::rgb565_nonswapped:   return dma2d_rgb565;
+            case color_depth_t::rgb888_nonswapped:   return dma2d_rgb888;
+            case color_depth_t::argb8888_nonswapped: return dma2d_argb8888;
+            default: return -1;
+            }
+        }
+
+        template <bool SrcSwap>
+        static bool read_rotated_565(void* dst, const uint16_t* src,
+                                     int32_t dx, int32_t dy,
+                                     uint_fast16_t w, uint_fast16_t h,
+                                     color_depth_t dst_depth)
+        {
+            using namespace kernels;
+            switch (dst_depth)
+            {
+            case color_depth_t::rgb565_2Byte:
+                read_rotated((uint16_t*)dst, src, dx, dy, w, h, conv_565_to_565<SrcSwap, true>());
+                return true;
+            case color_depth_t::rgb565_nonswapped:
+                read_rotated((uint16_t*)dst, src, dx, dy, w, h, conv_565_to_565<SrcSwap, false>());
+                return true;
+            case color_depth_t::rgb888_3Byte:
+                read_rotated((px24_t*)dst, src, dx, dy, w, h, conv_565_to_888<SrcSwap, true>());
+                return true;
+            case color_depth_t::rgb888_nonswapped:
+                read_rotated((px24_t*)dst, src, dx, dy, w, h, conv_565_to_888<SrcSwap, false>());
+                return true;
+            case color_depth_t::argb8888_4Byte:
+                read_rotated((uint32_t*)dst, src, dx, dy, w, h, conv_565_to_8888<SrcSwap, true>());
+                return true;
+            case color_depth_t::argb8888_nonswapped:
+                read_rotated((uint32_t*)dst, src, dx, dy, w, h, conv_565_to_8888<SrcSwap, false>());
+                return true;
+            default:
+                return false;
             }
         }
 
         Panel_LTDC::Panel_LTDC() : Panel_Device()
         {
+            _ltdc.Instance = nullptr;
+            _hltdc = &_ltdc;
         }
 
         bool Panel_LTDC::init(bool use_reset)
@@ -61,23 +137,144 @@ namespace lgfx
                 return false;
             }
 
-            _cfg.panel_width  = _panel_timing.h.active;
-            _cfg.panel_height = _panel_timing.v.active;
+            if (_base)
+            {
+                /// LTDC本体の設定は base 側で済んでいる
+                if (_base->_ltdc.Instance == nullptr)
+                {
+                    return false;
+                }
+                _hltdc = &_base->_ltdc;
+                _panel_timing = _base->_panel_timing;
+            }
+
+            _view_size(_view_w, _view_h);
+            /// 描画先は表示する範囲と仮想画面の大きい方
+            _cfg.panel_width  = std::max<uint_fast16_t>(_cfg.memory_width , _view_w);
+            _cfg.panel_height = std::max<uint_fast16_t>(_cfg.memory_height, _view_h);
+            _scroll_x = std::min<uint_fast16_t>(_scroll_x, _cfg.panel_width  - _view_w);
+            _scroll_y = std::min<uint_fast16_t>(_scroll_y, _cfg.panel_height - _view_h);
 
-            _setup_ltdc_clock();
-            _init_ltdc();
+            if (!_base)
+            {
+                _setup_ltdc_clock();
+                _init_ltdc();
+            }
             _init_ltdc_layer();
+            _dma2d.init();
+            _dirty.init(_cfg.panel_width, _cfg.panel_height);
 
             return Panel_Device::init(use_reset);
         }
 
         color_depth_t Panel_LTDC::setColorDepth(color_depth_t depth)
         {
-            _write_bits = 16;
-            _read_bits = 16;
-            _write_depth = color_depth_t::rgb565_2Byte;
-            _read_depth = color_depth_t::rgb565_2Byte;
-            return color_depth_t::rgb565_2Byte;
+            bool swap = !(depth & color_depth_t::nonswapped);
+            uint32_t format;
+            switch (depth & color_depth_t::bit_mask)
+            {
+            case 32:
+                format = LTDC_PIXEL_FORMAT_ARGB8888;
+                depth = swap ? color_depth_t::argb8888_4Byte : color_depth_t::argb8888_nonswapped;
+                break;
+
+            case 24:
+                format = LTDC_PIXEL_FORMAT_RGB888;
+                depth = swap ? color_depth_t::rgb888_3Byte : color_depth_t::rgb888_nonswapped;
+                break;
+
+            case 8:
+                format = LTDC_PIXEL_FORMAT_L8;
+                if (depth != color_depth_t::grayscale_8bit
+                 && depth != color_depth_t::palette_8bit)
+                {
+                    depth = color_depth_t::rgb332_1Byte;
+                }
+                break;
+
+            default:
+                format = LTDC_PIXEL_FORMAT_RGB565;
+                depth = swap ? color_depth_t::rgb565_2Byte : color_depth_t::rgb565_nonswapped;
+                break;
+            }
+            _set_format(format, depth);
+            return depth;
+        }
+
+        void Panel_LTDC::_view_size(uint16_t& w, uint16_t& h) const
+        {
+            const panel_timing_t& timing = _base ? _base->_panel_timing : _panel_timing;
+            w = _layer_w ? _layer_w : timing.h.active;
+            h = _layer_h ? _layer_h : timing.v.active;
+        }
+
+        void Panel_LTDC::setPixelFormat(uint32_t format)
+        {
+            color_depth_t depth = _format_depth(format);
+            _set_format(format, depth);
+        }
+
+        color_depth_t Panel_LTDC::_format_depth(uint32_t& format)
+        {
+            switch (format)
+            {
+            case LTDC_PIXEL_FORMAT_ARGB8888: return color_depth_t::argb8888_nonswapped;
+            case LTDC_PIXEL_FORMAT_RGB888:   return color_depth_t::rgb888_nonswapped;
+            case LTDC_PIXEL_FORMAT_AL88:     return color_depth_t::rgb565_nonswapped;
+            case LTDC_PIXEL_FORMAT_L8:       return color_depth_t::palette_8bit;
+            case LTDC_PIXEL_FORMAT_AL44:     return color_depth_t::palette_8bit;
+            default:
+                format = LTDC_PIXEL_FORMAT_RGB565;
+                return color_depth_t::rgb565_nonswapped;
+            }
+        }
+
+        void Panel_LTDC::setCLUT(const uint32_t* rgb888, size_t count)
+        {
+            _clut = rgb888;
+            _clut_size = count;
+            if (_hltdc->Instance)
+            {
+                _apply_clut();
+            }
+        }
+
+        void Panel_LTDC::_set_format(uint32_t format, color_depth_t depth)
+        {
+            _pixel_format = format;
+            _write_depth = depth;
+            _read_depth = depth;
+            _write_bits = depth & color_depth_t::bit_mask;
+            _read_bits = _write_bits;
+            if (_hltdc->Instance)
+            {
+                HAL_LTDC_SetPixelFormat(_hltdc, format, _layer);
+                /// 画素のバイト数が変わるとスクロール位置のアドレスも変わる
+                HAL_LTDC_SetAddress_NoReload(_hltdc, _scanout_address(), _layer);
+                _reload(LTDC_RELOAD_IMMEDIATE);
+                _apply_clut();
+            }
+        }
+
+        void Panel_LTDC::_apply_clut(void)
+        {
+            if (_pixel_format != LTDC_PIXEL_FORMAT_L8
+             && _pixel_format != LTDC_PIXEL_FORMAT_AL44)
+            {
+                HAL_LTDC_DisableCLUT(_hltdc, _layer);
+                return;
+            }
+            if (_clut)
+            {
+                HAL_LTDC_ConfigCLUT(_hltdc, (uint32_t*)_clut, _clut_size, _layer);
+            }
+            else
+            {
+                uint32_t clut[256];
+                size_t n = make_default_clut(clut, _pixel_format, _write_depth);
+                HAL_LTDC_ConfigCLUT(_hltdc, clut, n, _layer);
+            }
+            HAL_LTDC_EnableCLUT(_hltdc, _layer);
         }
 
         void Panel_LTDC::setRotation(uint_fast8_t r)
@@ -98,10 +295,10 @@ namespace lgfx
         void Panel_LTDC::setWindow(uint_fast16_t xs, uint_fast16_t ys,
                                     uint_fast16_t xe, uint_fast16_t ye)
         {
-            xs = std::max(0u, std::min<uint_fast16_t>(_width  - 1, xs));
-            xe = std::max(0u, std::min<uint_fast16_t>(_width  - 1, xe));
-            ys = std::max(0u, std::min<uint_fast16_t>(_height - 1, ys));
-            ye = std::max(0u, std::min<uint_fast16_t>(_height - 1, ye));
+            xs = std::min<uint_fast16_t>(_width  - 1, xs);
+            xe = std::min<uint_fast16_t>(_width  - 1, xe);
+            ys = std::min<uint_fast16_t>(_height - 1, ys);
+            ye = std::min<uint_fast16_t>(_height - 1, ye);
             _xpos = xs;
             _xs = xs;
             _xe = xe;
@@ -110,6 +307,177 @@ namespace lgfx
             _ye = ye;
         }
 
+        void Panel_LTDC::display(uint_fast16_t x, uint_fast16_t y,
+                                    uint_fast16_t w, uint_fast16_t h)
+        {
+            if (!isDoubleBuffered())
+            {
+                return;
+            }
+
+            /// 前回の切り替えが済むまで待つ
+            waitDisplay();
+
+            std::swap(_fb, _fb_disp);
+            HAL_LTDC_SetAddress_NoReload(_hltdc, _scanout_address(), _layer);
+            _reload(LTDC_RELOAD_VERTICAL_BLANKING);
+
+            if (_copy_forward)
+            {
+                /// 新しい描画先はVブランクまで表示中なので、切り替え後に複写する
+                waitDisplay();
+                dirty_rect_t rects[16];
+                size_t n = _dirty.getRects(rects, 16);
+                for (size_t i = 0; i < n; ++i)
+                {
+                    _copy_rect(_fb, _fb_disp, rects[i]);
+                }
+                _dirty.clear();
+            }
+        }
+
+        void Panel_LTDC::setLinePitch(uint32_t bytes)
+        {
+            _line_pitch = bytes;
+            if (_hltdc->Instance)
+            {
+                HAL_LTDC_SetAddress_NoReload(_hltdc, _scanout_address(), _layer);
+                _reload(LTDC_RELOAD_VERTICAL_BLANKING);
+            }
+        }
+
+        void Panel_LTDC::setScroll(uint_fast16_t x, uint_fast16_t y)
+        {
+            _scroll_x = x;
+            _scroll_y = y;
+            if (_hltdc->Instance)
+            {
+                /// 表示する範囲は仮想画面の中に収める
+                _scroll_x = std::min<uint_fast16_t>(x, _cfg.panel_width  - _view_w);
+                _scroll_y = std::min<uint_fast16_t>(y, _cfg.panel_height - _view_h);
+                HAL_LTDC_SetAddress_NoReload(_hltdc, _scanout_address(), _layer);
+                _reload(LTDC_RELOAD_VERTICAL_BLANKING);
+            }
+        }
+
+        uintptr_t Panel_LTDC::_scanout_address(void) const
+        {
+            size_t bytes = _write_bits >> 3;
+            return (uintptr_t)&_fb_disp[(_scroll_x + _scroll_y * _stride()) * bytes];
+        }
+
+        void Panel_LTDC::_reload(uint32_t reload_type)
+        {
+            /// HAL_LTDC_SetAddress などはピッチを ImageWidth から計算し直すため、反映の前に指定し直す
+            HAL_LTDC_SetPitch_NoReload(_hltdc, _stride(), _layer);
+            HAL_LTDC_Reload(_hltdc, reload_type);
+        }
+
+        void Panel_LTDC::setBaseLayer(Panel_LTDC* base, uint_fast8_t layer)
+        {
+            _base = base;
+            _layer = base ? layer : 0;
+        }
+
+        void Panel_LTDC::setLayerWindow(uint_fast16_t x, uint_fast16_t y,
+                                        uint_fast16_t w, uint_fast16_t h)
+        {
+            _layer_x = x;
+            _layer_y = y;
+            _layer_w = w;
+            _layer_h = h;
+        }
+
+        void Panel_LTDC::moveLayer(uint_fast16_t x, uint_fast16_t y)
+        {
+            _layer_x = x;
+            _layer_y = y;
+            if (_hltdc->Instance)
+            {
+                /// ウィンドウは画面内に収める
+                x = std::min<uint_fast16_t>(x, _panel_timing.h.active - _view_w);
+                y = std::min<uint_fast16_t>(y, _panel_timing.v.active - _view_h);
+                HAL_LTDC_SetWindowPosition_NoReload(_hltdc, x, y, _layer);
+                _reload(LTDC_RELOAD_VERTICAL_BLANKING);
+            }
+        }
+
+        void Panel_LTDC::setLayerAlpha(uint8_t alpha)
+        {
+            _layer_alpha = alpha;
+            if (_hltdc->Instance)
+            {
+                HAL_LTDC_SetAlpha_NoReload(_hltdc, alpha, _layer);
+                _reload(LTDC_RELOAD_VERTICAL_BLANKING);
+            }
+        }
+
+        void Panel_LTDC::setColorKey(uint32_t rgb888)
+        {
+            _color_key = rgb888;
+            _use_color_key = true;
+            if (_hltdc->Instance)
+            {
+                _apply_color_key();
+                HAL_LTDC_Reload(_hltdc, LTDC_RELOAD_VERTICAL_BLANKING);
+            }
+        }
+
+        void Panel_LTDC::disableColorKey(void)
+        {
+            _use_color_key = false;
+            if (_hltdc->Instance)
+            {
+                _apply_color_key();
+                HAL_LTDC_Reload(_hltdc, LTDC_RELOAD_VERTICAL_BLANKING);
+            }
+        }
+
+        void Panel_LTDC::setLayerVisible(bool visible)
+        {
+            _layer_visible = visible;
+            if (_hltdc->Instance)
+            {
+                if (visible)
+                {
+                    __HAL_LTDC_LAYER_ENABLE(_hltdc, _layer);
+                }
+                else
+                {
+                    __HAL_LTDC_LAYER_DISABLE(_hltdc, _layer);
+                }
+                HAL_LTDC_Reload(_hltdc, LTDC_RELOAD_VERTICAL_BLANKING);
+            }
+        }
+
+        void Panel_LTDC::_apply_color_key(void)
+        {
+            if (_use_color_key)
+            {
+                HAL_LTDC_ConfigColorKeying_NoReload(_hltdc, _color_key, _layer);
+                HAL_LTDC_EnableColorKeying_NoReload(_hltdc, _layer);
+            }
+            else
+            {
+                HAL_LTDC_DisableColorKeying_NoReload(_hltdc, _layer);
+            }
+        }
+
+        void Panel_LTDC::waitDisplay(void)
+        {
+            _dma2d.wait();
+            while (displayBusy());
+        }
+
+        bool Panel_LTDC::displayBusy(void)
+        {
+            /// VBRビットはリロード完了時にハードウェアでクリアされる。
+            /// レイヤーの移動などシングルバッファでもリロードを待つ場合がある
+            return _dma2d.busy()
+                || (_hltdc->Instance
+                 && (_hltdc->Instance->SRCR & LTDC_SRCR_VBR));
+        }
+
         void Panel_LTDC::writeBlock(uint32_t rawcolor, uint32_t length)
         {
             do {
@@ -142,10 +510,50 @@ namespace lgfx
             uint_fast16_t ye = _ye;
             uint_fast16_t x = _xpos;
             uint_fast16_t y = _ypos;
+            {
+                uint_fast16_t ww = xe - xs + 1;
+                uint_fast16_t rows = (x - xs + length + ww - 1) / ww;
+                if (y + rows > ye + 1u)
+                {
+                    _mark_dirty(xs, ys, ww, ye - ys + 1);
+                }
+                else
+                {
+                    _mark_dirty(xs, y, ww, rows);
+                }
+            }
             const size_t bits = _write_bits;
-            auto k = _cfg.panel_width * bits >> 3;
+            auto k = _stride() * bits >> 3;
 
             uint_fast8_t r = _internal_rotation;
+            int format = dma2d_format_from_bits(bits);
+            if (!r && use_dma && param->no_convert && format >= 0 && x == xs)
+            {
+                /// 窓の幅の行をまとめて DMA2D で転送し、完了を待たずに戻る
+                uint_fast16_t ww = xe - xs + 1;
+                uint32_t rows = std::min<uint32_t>(length / ww, ye - y + 1);
+                size_t bytes = bits >> 3;
+                auto src = (const uint8_t*)param->src_data + param->src_x * bytes;
+                if (rows && _dma2d.copy(&_fb[y * k + x * bytes], k, src, ww * bytes,
+                                        ww, rows, (dma2d_format_t)format, true))
+                {
+                    /// 残りは続きから読む
+                    param->src_data = src + rows * ww * bytes - param->src_x * bytes;
+                    length -= rows * ww;
+                    y += rows;
+                    if (y > ye)
+                    {
+                        y = ys;
+                    }
+                    if (!length)
+                    {
+                        _xpos = x;
+                        _ypos = y;
+                        return;
+                    }
+                }
+            }
+            _dma2d.wait();
             if (!r)
             {
                 uint_fast16_t linelength;
@@ -162,94 +570,48 @@ namespace lgfx
                 _ypos = y;
             return;
             }
-
-            int_fast16_t ax = 1;
-            int_fast16_t ay = 1;
-            if ((1u << r) & 0b10010110)
-            {
-                y = _height - (y + 1);
-                ys = _height - (ys + 1);
-                ye = _height - (ye + 1);
-                ay = -1;
-            }
-            if (r & 2)
-            {
-                x = _width - (x + 1);
-                xs = _width - (xs + 1);
-                xe = _width - (xe + 1);
-                ax = -1;
-            }
-            if (param->no_convert)
-            {
-                size_t bytes = bits >> 3;
-                size_t xw = 1;
-                size_t yw = _cfg.panel_width;
-                if (r & 1)
+            /// 1行ずつ、または窓の幅いっぱいの複数行をまとめて回転転送する
+            uint8_t buf[1024];
+            size_t bytes = bits >> 3;
+            size_t cap = sizeof(buf) / bytes;
+            auto data = (const uint8_t*)param->src_data;
+            uint_fast16_t ww = xe - xs + 1;
+            do {
+                uint_fast16_t w = std::min<uint32_t>(xe - x + 1, length);
+                uint_fast16_t h = 1;
+                if (x == xs && length >= ww)
                 {
-                    std::swap(xw, yw);
+                    h = std::min<uint32_t>(length / ww, ye - y + 1);
                 }
-                size_t idx = y * yw + x * xw;
-                auto data = (uint8_t*)param->src_data;
-                do {
-                    auto dst = &_fb[idx * bytes];
-                    size_t b = 0;
-                    do {
-                        dst[b] = *data++;
-                    } while (++b < bytes);
-                    if (x != xe)
-                    {
-                        idx += xw * ax;
-                        x += ax;
-                    }
-                    else
-                    {
-                        x = xs;
-                        y = (y != ye) ? (y + ay) : ys;
-                        idx = y * yw + x * xw;
-                    }
-                } while (--length);
-            }
-            else
-            {
-                if (r & 1)
+                const void* src = data;
+                if (param->no_convert)
                 {
-                    do {
-                        param->fp_copy(&_fb[x * k], y, y + 1, param); /// xとyを入れ替えて処理する;
-                        if (x != xe)
-                        {
-                            x += ax;
-                        }
-                        else
-                        {
-                            x = xs;
-                            y = (y != ye) ? (y + ay) : ys;
-                        }
-                    } while (--length);
+                    data += w * h * bytes;
                 }
                 else
                 {
-                    do {
-                        param->fp_copy(&_fb[y * k], x, x + 1, param);
-                        if (x != xe)
-                        {
-                            x += ax;
-                        }
-                        else
-                        {
-                            x = xs;
-                            y = (y != ye) ? (y + ay) : ys;
-                        }
-                    } while (--length);
+                    if (w > cap)
+                    {
+                        w = cap;
+                    }
+                    h = std::max<uint_fast16_t>(1, std::min<uint_fast16_t>(h, cap / w));
+                    param->fp_copy(buf, 0, w * h, param);
+                    src = buf;
                 }
-            }
-            if ((1u << r) & 0b10010110)
-            {
-                y = _height - (y + 1);
-            }
-            if (r & 2)
-            {
-                x = _width  - (x + 1);
-            }
+                int32_t dx, dy;
+                size_t idx = _rotated_index(x, y, dx, dy);
+                kernels::blit_rotated_bytes(&_fb[idx * bytes], dx, dy, src, w, w, h, bytes);
+                length -= w * h;
+                if ((x += w) > xe)
+                {
+                    x = xs;
+                    y += h;
+                    if (y > ye)
+                    {
+                        y = ys;
+                    }
+                }
+            } while (length);
             _xpos = x;
             _ypos = y;
         }
@@ -257,6 +619,7 @@ namespace lgfx
         void Panel_LTDC::drawPixelPreclipped(uint_fast16_t x, uint_fast16_t y,
                                                 uint32_t rawcolor)
         {
+            _dma2d.wait();
             uint_fast8_t r = _internal_rotation;
             if (r)
             {
@@ -273,16 +636,18 @@ namespace lgfx
                     std::swap(x, y);
                 }
             }
-            size_t bw = _cfg.panel_width;
-            size_t index = x + y * bw;
-            {
-                auto img = &((rgb565_t*)_fb)[index];
-                *img = rawcolor;
-            }
+            _dirty.add(x, y);
+            size_t bw = _stride();
+            size_t bytes = _write_bits >> 3;
+            store_pixel(&_fb[(x + y * bw) * bytes], rawcolor, bytes);
 
             if (!getStartCount())
             {
-                display(x, y, 1, 1);
+                waitDisplay();
+                if (_auto_display)
+                {
+                    display(x, y, 1, 1);
+                }
             }
         }
 
@@ -290,6 +655,7 @@ namespace lgfx
                             uint_fast16_t x, uint_fast16_t y,
                             uint_fast16_t w, uint_fast16_t h, uint32_t rawcolor)
         {
+            if (_capture_span(x, y, w, h, rawcolor)) return;
             uint_fast8_t r = _internal_rotation;
             if (r)
             {
@@ -307,41 +673,183 @@ namespace lgfx
                     std::swap(w, h);
                 }
             }
+            _dirty.add(x, y, w, h);
+            uint_fast8_t bytes = _write_bits >> 3;
+            uint_fast16_t bw = _stride();
+            uint8_t* dst = &_fb[(x + y * bw) * bytes];
+            int format = dma2d_format_from_bits(_write_bits);
+            if (format >= 0
+             && _dma2d.fill(dst, bw * bytes, w, h, rawcolor, (dma2d_format_t)format))
+            {
+                return;
+            }
+            _dma2d.wait();
             if (w > 1)
             {
-                uint_fast8_t bytes = 2;
-                uint_fast16_t bw = _cfg.panel_width;
-                uint8_t* dst = &_fb[(x + y * bw) * bytes];
-                uint8_t* src = dst;
-                uint_fast16_t add_dst = bw * bytes;
-                uint_fast16_t len = w * bytes;
-
-                if (w != bw)
+                /// 1行目を複写するとSDRAMの読み出しが増えるため、各行を直接埋める
+                if (w == bw)
                 {
-                    dst += add_dst;
+                    kernels::fill(dst, rawcolor, bytes, (size_t)w * h);
+                    return;
                 }
-                else
+                size_t add_dst = bw * bytes;
+                do {
+                    kernels::fill(dst, rawcolor, bytes, w);
+                    dst += add_dst;
+                } while (--h);
+            }
+            else
+            {
+                size_t add_dst = bw * bytes;
+                do {
+                    store_pixel(dst, rawcolor, bytes);
+                    dst += add_dst;
+                } while (--h);
+            }
+        }
+
+        void Panel_LTDC::fillSpans(const span_t* spans, uint32_t count, uint32_t rawcolor)
+        {
+            if (!count) return;
+            _dma2d.wait();
+            /// 各区間の先頭は原点と論理座標1つ分の移動量から求める
+            int32_t dx, dy;
+            size_t origin = _rotated_index(0, 0, dx, dy);
+            uint_fast8_t bytes = _write_bits >> 3;
+            uint8_t* fb = &_fb[origin * bytes];
+            ptrdiff_t step_x = dx * (ptrdiff_t)bytes;
+            ptrdiff_t step_y = dy * (ptrdiff_t)bytes;
+            bool row = (dx == 1 || dx == -1);
+
+            uint_fast16_t l = ~0u, r = 0, t = ~0u, b = 0;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                uint_fast16_t x = spans[i].x;
+                uint_fast16_t y = spans[i].y;
+                uint_fast16_t w = spans[i].w;
+                if (!w) continue;
+                uint8_t* dst = fb + x * step_x + y * step_y;
+                if (row)
                 {
-                    w *= h;
-                    h = 1;
+                    if (step_x < 0) { dst += (w - 1) * step_x; }
+                    kernels::fill(dst, rawcolor, bytes, w);
                 }
-                memset_multi(src, rawcolor, bytes, w);
-                while (--h)
+                else
                 {
-                    memcpy(dst, src, len);
-                    dst += add_dst;
+                    kernels::fill_strided(dst, rawcolor, bytes, w, step_x);
                 }
+                if (l > x) { l = x; }
+                if (r < x + w) { r = x + w; }
+                if (t > y) { t = y; }
+                if (b < y) { b = y; }
+            }
+            if (l < r)
+            {
+                _mark_dirty(l, t, r - l, b - t + 1);
+            }
+        }
+
+        template <typename T>
+        static void polyline(uint8_t* origin, int32_t dx, int32_t dy,
+                             const Panel_LTDC::point_t* points, uint32_t count, uint32_t rawcolor)
+        {
+            for (uint32_t i = 1; i < count; ++i)
+            {
+                kernels::line((T*)origin, dx, dy, points[i - 1].x, points[i - 1].y,
+                              points[i].x, points[i].y, rawcolor);
+            }
+        }
+
+        void Panel_LTDC::drawPolylinePreclipped(const point_t* points, uint32_t count, uint32_t rawcolor)
+        {
+            if (!count) return;
+            _dma2d.wait();
+            int32_t dx, dy;
+            size_t origin = _rotated_index(0, 0, dx, dy);
+            uint_fast8_t bytes = _write_bits >> 3;
+            uint8_t* fb = &_fb[origin * bytes];
+            if (count == 1)
+            {
+                /// 頂点が1つの場合は点を描く
+                store_pixel(fb + (points[0].x * dx + points[0].y * dy) * (ptrdiff_t)bytes, rawcolor, bytes);
+                _mark_line_dirty(points[0].x, points[0].y, points[0].x, points[0].y);
+                return;
+            }
+            switch (bytes)
+            {
+            case 1:  polyline<uint8_t         >(fb, dx, dy, points, count, rawcolor); break;
+            case 2:  polyline<uint16_t        >(fb, dx, dy, points, count, rawcolor); break;
+            case 3:  polyline<kernels::px24_t >(fb, dx, dy, points, count, rawcolor); break;
+            default: polyline<uint32_t        >(fb, dx, dy, points, count, rawcolor); break;
+            }
+            for (uint32_t i = 1; i < count; ++i)
+            {
+                _mark_line_dirty(points[i - 1].x, points[i - 1].y, points[i].x, points[i].y);
+            }
+        }
+
+        void Panel_LTDC::fillRectAlphaPreclipped(uint_fast16_t x, uint_fast16_t y,
+                                                 uint_fast16_t w, uint_fast16_t h,
+                                                 uint32_t rgb888, uint8_t alpha)
+        {
+            uint32_t a = kernels::alpha5(alpha);
+            if (!canBlend() || !a) return;
+            uint32_t c = kernels::rgb888_to_rgb565(rgb888);
+            bool swap = !(_write_depth & color_depth_t::nonswapped);
+            if (a == 32)
+            {
+                writeFillRectPreclipped(x, y, w, h, swap ? kernels::swap565x2(c) : c);
+                return;
+            }
+            _dma2d.wait();
+            /// 矩形は回転しても矩形なので、物理座標の各行を連続したアドレスとして処理する
+            _rotate_rect(x, y, w, h);
+            _dirty.add(x, y, w, h);
+            uint_fast16_t bw = _stride();
+            auto dst = &((uint16_t*)_fb)[x + y * bw];
+            do {
+                if (swap) { kernels::blend_fill565<true >(dst, c, a, w); }
+                else      { kernels::blend_fill565<false>(dst, c, a, w); }
+                dst += bw;
+            } while (--h);
+        }
+
+        void Panel_LTDC::blendImagePreclipped(uint_fast16_t x, uint_fast16_t y,
+                                              uint_fast16_t w, uint_fast16_t h,
+                                              const uint32_t* argb8888, uint32_t pitch)
+        {
+            if (!canBlend()) return;
+            _dma2d.wait();
+            _mark_dirty(x, y, w, h);
+            int32_t dx, dy;
+            auto dst = &((uint16_t*)_fb)[_rotated_index(x, y, dx, dy)];
+            if (_write_depth & color_depth_t::nonswapped)
+            {
+                kernels::apply_rotated(dst, dx, dy, argb8888, pitch, w, h, kernels::blend_argb8888_565<false>());
             }
             else
             {
-                size_t bw = _cfg.panel_width;
-                size_t index = x + y * bw;
-                {
-                    auto img = &((rgb565_t*)_fb)[index];
-                    do {
-                        *img = rawcolor; img += bw;
-                    } while (--h);
-                }
+                kernels::apply_rotated(dst, dx, dy, argb8888, pitch, w, h, kernels::blend_argb8888_565<true>());
+            }
+        }
+
+        void Panel_LTDC::blendMaskPreclipped(uint_fast16_t x, uint_fast16_t y,
+                                             uint_fast16_t w, uint_fast16_t h,
+                                             const uint8_t* alpha, uint32_t pitch, uint32_t rgb888)
+        {
+            if (!canBlend()) return;
+            _dma2d.wait();
+            _mark_dirty(x, y, w, h);
+            int32_t dx, dy;
+            auto dst = &((uint16_t*)_fb)[_rotated_index(x, y, dx, dy)];
+            uint32_t c = kernels::rgb888_to_rgb565(rgb888);
+            if (_write_depth & color_depth_t::nonswapped)
+            {
+                kernels::apply_rotated(dst, dx, dy, alpha, pitch, w, h, kernels::blend_a8_565<false>{ c });
+            }
+            else
+            {
+                kernels::apply_rotated(dst, dx, dy, alpha, pitch, w, h, kernels::blend_a8_565<true>{ c });
             }
         }
 
@@ -349,20 +857,41 @@ namespace lgfx
                                     uint_fast16_t w, uint_fast16_t h,
                                     pixelcopy_t* param, bool use_dma)
         {
+            _mark_dirty(x, y, w, h);
+
+            /// 回転を伴わない拡大・縮小 (pushImageRotateZoom の角度0・拡大したスプライト) は列の表を使って書く
+            if ((param->no_convert || param->src_depth == _write_depth)
+             && param->src_bits == _write_bits && _write_bits >= 8
+             && param->src_x32_add != 1 << pixelcopy_t::FP_SCALE
+             && param->src_y32_add == 0
+             && _write_scaled(x, y, w, h, param))
+            {
+                return;
+            }
+
             uint_fast8_t r = _internal_rotation;
             if (r == 0 &&
-                param->transp == pixelcopy_t::NON_TRANSP && param->no_convert)
+                param->transp == pixelcopy_t::NON_TRANSP && param->no_convert
+             && param->src_x32_add == 1 << pixelcopy_t::FP_SCALE
+             && param->src_y32_add == 0)
             {
                 auto sx = param->src_x;
                 auto bits = param->src_bits;
 
-                auto bw = _cfg.panel_width * bits >> 3;
+                auto bw = _stride() * bits >> 3;
                 auto dst = _fb + (bw * y);
                 auto sw = param->src_bitwidth * bits >> 3;
                 auto src = &((uint8_t*)param->src_data)[param->src_y * sw];
                 y = 0;
                 dst +=  x * bits >> 3;
                 src += sx * bits >> 3;
+                int format = dma2d_format_from_bits(bits);
+                if (format >= 0
+                 && _dma2d.copy(dst, bw, src, sw, w, h, (dma2d_format_t)format, use_dma))
+                {
+                    return;
+                }
+                _dma2d.wait();
                 w    =  w * bits >> 3;
                 do {
                     memcpy(&dst[y * bw], &src[y * sw], w);
@@ -370,6 +899,60 @@ namespace lgfx
                 return;
             }
 
+            if (r == 0 && param->transp == pixelcopy_t::NON_TRANSP
+             && param->src_x32_add == 1 << pixelcopy_t::FP_SCALE
+             && param->src_y32_add == 0)
+            {
+                int sf = dma2d_format_from_depth(param->src_depth);
+                int df = _dma2d_native_format();
+                if (sf >= 0 && df >= 0)
+                {
+                    auto sbits = param->src_bits;
+                    auto sw = param->src_bitwidth * sbits >> 3;
+                    auto src = &((uint8_t*)param->src_data)[param->src_y * sw
+                                                          + (param->src_x * sbits >> 3)];
+                    auto bw = _stride() * _write_bits >> 3;
+                    auto dst = &_fb[bw * y + (x * _write_bits >> 3)];
+                    if (_dma2d.convert(dst, bw, (dma2d_format_t)df,
+                                       src, sw, (dma2d_format_t)sf, w, h, use_dma))
+                    {
+                        return;
+                    }
+                }
+            }
+            _dma2d.wait();
+
+            /// 透過色を持つ画像 (スプライト) は、透過しない画素の連続ごとに直接書く。全ての回転で使う
+            if (param->no_convert && param->transp != pixelcopy_t::NON_TRANSP
+             && param->src_bits == _write_bits && _write_bits >= 8
+             && param->src_x32_add == 1 << pixelcopy_t::FP_SCALE
+             && param->src_y32_add == 0)
+            {
+                size_t bytes = _write_bits >> 3;
+                auto src = &((const uint8_t*)param->src_data)[
+                    (param->src_y * param->src_bitwidth + param->src_x) * bytes];
+                int32_t dx, dy;
+                size_t idx = _rotated_index(x, y, dx, dy);
+                kernels::blit_keyed_bytes(&_fb[idx * bytes], dx, dy,
+                                          src, param->src_bitwidth, w, h, param->transp, bytes);
+                return;
+            }
+
+            if (r && param->no_convert
+             && param->transp == pixelcopy_t::NON_TRANSP
+             && param->src_x32_add == 1 << pixelcopy_t::FP_SCALE
+             && param->src_y32_add == 0)
+            {
+                size_t bytes = _write_bits >> 3;
+                auto src = &((const uint8_t*)param->src_data)[
+                    (param->src_y * param->src_bitwidth + param->src_x) * bytes];
+                int32_t dx, dy;
+                size_t idx = _rotated_index(x, y, dx, dy);
+                kernels::blit_rotated_bytes(&_fb[idx * bytes], dx, dy,
+                                      src, param->src_bitwidth, w, h, bytes);
+                return;
+            }
+
             uint32_t nextx = 0;
             uint32_t nexty = 1 << pixelcopy_t::FP_SCALE;
             if (r)
@@ -379,7 +962,8 @@ namespace lgfx
             uint32_t sx32 = param->src_x32;
             uint32_t sy32 = param->src_y32;
 
-            y *= _cfg.panel_width;
+            uint32_t bw = _stride();
+            y *= bw;
             do {
                 int32_t pos = x + y;
                 int32_t end = pos + w;
@@ -387,21 +971,277 @@ namespace lgfx
                     &&  end != (pos = param->fp_skip(pos, end, param)));
                 param->src_x32 = (sx32 += nextx);
                 param->src_y32 = (sy32 += nexty);
-                y += _cfg.panel_width;
+                y += bw;
+            } while (--h);
+        }
+
+        /// 拡大・縮小の列の表 (各画素が読む元画像の列)。表は位置・倍率・幅だけで決まるので、全てのパネルで1つを共有する。
+        /// LovyanGFX は1行ずつ writeImage を呼ぶため、src_x32・倍率・幅が前回と同じ間は作り直さない
+        struct scale_table_t
+        {
+            static constexpr size_t cols_max = 512;
+            uint16_t cols[cols_max];
+            uint8_t frac[cols_max];  // 双線形補間の右の画素の重み (0〜32)
+            uint32_t x32;
+            uint32_t add;
+            uint16_t w;       // 0 は表が無効
+            uint16_t src_w;   // 双線形補間の場合は元画像の幅、最近傍は 0
+            uint8_t rep;      // 2〜4 の場合、各列が rep 個ずつ並ぶ (整数倍の拡大)
+            uint8_t head;     // 整数倍の場合、先頭の列が並ぶ数 (クリップで欠けることがある)
+
+            bool build(uint32_t start_x32, uint32_t step, uint_fast16_t width, uint_fast16_t image_w);
+        };
+        static scale_table_t scale_table;
+
+        bool scale_table_t::build(uint32_t start_x32, uint32_t step, uint_fast16_t width, uint_fast16_t image_w)
+        {
+            if (width > cols_max) { return false; }
+            if (w == width && x32 == start_x32 && add == step && src_w == image_w)
+            {
+                return true;
+            }
+            w = 0;
+
+            /// 最近傍は src_x32 の整数部の列を読む。双線形補間は画素の中心 (0.5) を基準にして左右の列の重みを求める
+            int32_t pos = (int32_t)start_x32 - (image_w ? 1 << (pixelcopy_t::FP_SCALE - 1) : 0);
+            for (uint_fast16_t i = 0; i < width; ++i, pos += (int32_t)step)
+            {
+                int32_t c = pos >> pixelcopy_t::FP_SCALE;
+                uint_fast8_t f = 0;
+                if (image_w)
+                {
+                    f = ((pos & ((1 << pixelcopy_t::FP_SCALE) - 1)) + (1 << (pixelcopy_t::FP_SCALE - 6))) >> (pixelcopy_t::FP_SCALE - 5);
+                    if (c < 0)                          { c = 0;           f = 0; }
+                    else if (c >= (int32_t)image_w - 1) { c = image_w - 1; f = 0; }
+                }
+                else if (c < 0 || c > UINT16_MAX)
+                {
+                    return false;
+                }
+                cols[i] = c;
+                frac[i] = f;
+            }
+
+            /// 2〜4倍の整数倍の拡大か調べる。各列が rep 個ずつ並ぶ (先頭はクリップで欠けてよい)
+            rep = 0;
+            if (!image_w && step < 1u << pixelcopy_t::FP_SCALE)
+            {
+                uint32_t k = ((1u << pixelcopy_t::FP_SCALE) + (step >> 1)) / step;
+                if (k >= 2 && k <= 4)
+                {
+                    uint_fast16_t n = 1;
+                    while (n < width && cols[n] == cols[0]) { ++n; }
+                    bool ok = n <= k && n < width;
+                    for (uint_fast16_t i = n; ok && i < width; ++i)
+                    {
+                        ok = cols[i] == cols[n] + (i - n) / k;
+                    }
+                    if (ok)
+                    {
+                        rep = k;
+                        head = n;
+                    }
+                }
+            }
+            x32 = start_x32;
+            add = step;
+            src_w = image_w;
+            w = width;
+            return true;
+        }
+
+        /// 列の表に従って h 行を書く (最近傍)。rep は整数倍の拡大 (dx == 1 の場合のみ使う)
+        template <typename T>
+        static void scale_rows(uint8_t* dst, int32_t dx, int32_t dy, const uint8_t* src, size_t spitch,
+                               const uint16_t* cols, uint_fast16_t w, uint_fast16_t h,
+                               uint_fast8_t rep, uint_fast8_t head, uint32_t transp)
+        {
+            auto d = (T*)dst;
+            auto s = (const T*)src;
+            do {
+                if (transp != pixelcopy_t::NON_TRANSP)
+                {
+                    kernels::scale_row_keyed(d, dx, s, cols, w, transp);
+                }
+                else if (rep && dx == 1)
+                {
+                    /// 先頭の欠けた列、rep 個ずつの列、末尾の欠けた列に分けて書く
+                    auto p = d;
+                    auto c = s + cols[head];
+                    for (uint_fast8_t i = 0; i < head; ++i) { *p++ = s[cols[0]]; }
+                    uint_fast16_t n = (w - head) / rep;
+                    if (n)
+                    {
+                        kernels::replicate(p, c, n, rep);
+                        p += n * rep;
+                        c += n;
+                    }
+                    for (uint_fast16_t i = (w - head) % rep; i; --i) { *p++ = *c; }
+                }
+                else
+                {
+                    kernels::scale_row(d, dx, s, cols, w);
+                }
+                d += dy;
+                s += spitch;
             } while (--h);
         }
 
+        bool Panel_LTDC::_write_scaled(uint_fast16_t x, uint_fast16_t y,
+                                       uint_fast16_t w, uint_fast16_t h, pixelcopy_t* param)
+        {
+            uint_fast8_t bytes = _write_bits >> 3;
+            bool bilinear = _bilinear && _pixel_format == LTDC_PIXEL_FORMAT_RGB565
+                         && param->transp == pixelcopy_t::NON_TRANSP
+                         && param->src_width && param->src_height;
+            if (!scale_table.build(param->src_x32, param->src_x32_add, w, bilinear ? param->src_width : 0))
+            {
+                return false;
+            }
+            _dma2d.wait();
+
+            int32_t dx, dy;
+            auto dst = &_fb[_rotated_index(x, y, dx, dy) * bytes];
+            auto src = (const uint8_t*)param->src_data;
+            size_t spitch = param->src_bitwidth;
+            int32_t sy32 = param->src_y32;
+
+            if (bilinear)
+            {
+                auto d = (uint16_t*)dst;
+                auto s = (const uint16_t*)src;
+                bool swap = _write_depth == color_depth_t::rgb565_2Byte;
+                int32_t last_row = param->src_height - 1;
+                sy32 -= 1 << (pixelcopy_t::FP_SCALE - 1);
+                do {
+                    int32_t row = sy32 >> pixelcopy_t::FP_SCALE;
+                    uint32_t fy = ((sy32 & ((1 << pixelcopy_t::FP_SCALE) - 1)) + (1 << (pixelcopy_t::FP_SCALE - 6))) >> (pixelcopy_t::FP_SCALE - 5);
+                    if (row < 0)              { row = 0;        fy = 0; }
+                    else if (row >= last_row) { row = last_row; fy = 0; }
+                    auto s0 = s + row * spitch;
+                    auto s1 = fy ? s0 + spitch : s0;
+                    if (swap) { kernels::bilinear_row565<true >(d, dx, s0, s1, scale_table.cols, scale_table.frac, w, fy, scale_table.src_w - 1); }
+                    else      { kernels::bilinear_row565<false>(d, dx, s0, s1, scale_table.cols, scale_table.frac, w, fy, scale_table.src_w - 1); }
+                    d += dy;
+                    sy32 += 1 << pixelcopy_t::FP_SCALE;
+                } while (--h);
+                return true;
+            }
+
+            /// writeImage の他の経路と同じく、h が 2 以上の場合は1行ごとに元画像も1行進める
+            src += (size_t)(sy32 >> pixelcopy_t::FP_SCALE) * spitch * bytes;
+            uint32_t transp = param->transp;
+            switch (bytes)
+            {
+            case 1:
+                if (transp != pixelcopy_t::NON_TRANSP) { transp &= 0xFF; }
+                scale_rows<uint8_t        >(dst, dx, dy, src, spitch, scale_table.cols, w, h, scale_table.rep, scale_table.head, transp);
+                break;
+            case 2:
+                if (transp != pixelcopy_t::NON_TRANSP) { transp &= 0xFFFF; }
+                scale_rows<uint16_t       >(dst, dx, dy, src, spitch, scale_table.cols, w, h, scale_table.rep, scale_table.head, transp);
+                break;
+            case 3:
+                if (transp != pixelcopy_t::NON_TRANSP) { transp &= 0xFFFFFF; }
+                scale_rows<kernels::px24_t>(dst, dx, dy, src, spitch, scale_table.cols, w, h, scale_table.rep, scale_table.head, transp);
+                break;
+            default:
+                scale_rows<uint32_t       >(dst, dx, dy, src, spitch, scale_table.cols, w, h, scale_table.rep, scale_table.head, transp);
+                break;
+            }
+            return true;
+        }
+
+        template <typename T>
+        static void blit_runs(uint8_t* dst, int32_t dx, int32_t dy, const uint8_t* src,
+                              const SpriteMask& mask, uint_fast16_t mask_x, uint_fast16_t mask_y,
+                              uint_fast16_t w, uint_fast16_t h)
+        {
+            auto d = (T*)dst;
+            auto s = (const T*)src + mask_y * mask.pitch();
+            uint_fast16_t right = mask_x + w;
+            for (uint_fast16_t j = 0; j < h; ++j)
+            {
+                auto run = mask.row(mask_y + j);
+                for (uint_fast16_t n = *run++; n; --n, run += 2)
+                {
+                    uint_fast16_t a = run[0];
+                    uint_fast16_t e = a + run[1];
+                    if (e <= mask_x) continue;
+                    if (a >= right) break;
+                    a = std::max(a, mask_x);
+                    e = std::min(e, right);
+                    kernels::write_run(d + (ptrdiff_t)(a - mask_x) * dx, dx, s + a, e - a);
+                }
+                d += dy;
+                s += mask.pitch();
+            }
+        }
+
+        void Panel_LTDC::writeImageMasked(uint_fast16_t x, uint_fast16_t y,
+                                          uint_fast16_t w, uint_fast16_t h,
+                                          const void* src, const SpriteMask& mask,
+                                          uint_fast16_t mask_x, uint_fast16_t mask_y)
+        {
+            uint_fast8_t bytes = _write_bits >> 3;
+            if (!mask.isValid() || mask.bytes() != bytes) return;
+            _dma2d.wait();
+            _mark_dirty(x, y, w, h);
+            int32_t dx, dy;
+            auto dst = &_fb[_rotated_index(x, y, dx, dy) * bytes];
+            auto s = (const uint8_t*)src;
+            switch (bytes)
+            {
+            case 1:  blit_runs<uint8_t        >(dst, dx, dy, s, mask, mask_x, mask_y, w, h); break;
+            case 2:  blit_runs<uint16_t       >(dst, dx, dy, s, mask, mask_x, mask_y, w, h); break;
+            case 3:  blit_runs<kernels::px24_t>(dst, dx, dy, s, mask, mask_x, mask_y, w, h); break;
+            default: blit_runs<uint32_t       >(dst, dx, dy, s, mask, mask_x, mask_y, w, h); break;
+            }
+        }
+
         void Panel_LTDC::readRect(uint_fast16_t x, uint_fast16_t y,
                                     uint_fast16_t w, uint_fast16_t h,
                                     void* dst, pixelcopy_t* param)
         {
+            _dma2d.wait();
             uint_fast8_t r = _internal_rotation;
+            if (r || !param->no_convert)
+            {
+                int32_t dx, dy;
+                size_t idx = _rotated_index(x, y, dx, dy);
+                if (param->no_convert)
+                {
+                    size_t bytes = _read_bits >> 3;
+                    kernels::read_rotated_bytes(dst, &_fb[idx * bytes], dx, dy, w, h, bytes);
+                    return;
+                }
+                if (_pixel_format == LTDC_PIXEL_FORMAT_RGB565)
+                {
+                    auto src = &((const uint16_t*)_fb)[idx];
+                    if ((_read_depth & color_depth_t::nonswapped)
+                        ? read_rotated_565<false>(dst, src, dx, dy, w, h, param->dst_depth)
+                        : read_rotated_565<true >(dst, src, dx, dy, w, h, param->dst_depth))
+                    {
+                        return;
+                    }
+                }
+            }
+
             if (0 == r && param->no_convert)
             {
                 h += y;
                 auto bytes = _write_bits >> 3;
-                auto bw = _cfg.panel_width;
+                auto bw = _stride();
                 auto d = (uint8_t*)dst;
+                int format = dma2d_format_from_bits(_write_bits);
+                size_t size = (size_t)w * bytes * (h - y);
+                if (format >= 0 && dcache_line_aligned(d, size)
+                 && _dma2d.copy(d, w * bytes, &_fb[(x + y * bw) * bytes], bw * bytes,
+                                w, h - y, (dma2d_format_t)format))
+                {
+                    dcache_invalidate(d, size);
+                    return;
+                }
                 w *= bytes;
                 do {
                     memcpy(d, &_fb[(x + y * bw) * bytes], w);
@@ -410,7 +1250,7 @@ namespace lgfx
             }
             else
             {
-                param->src_bitwidth = _cfg.panel_width;
+                param->src_bitwidth = _stride();
                 param->src_data = _fb;
                 uint32_t nextx = 0;
                 uint32_t nexty = 1 << pixelcopy_t::FP_SCALE;
@@ -457,6 +1297,198 @@ namespace lgfx
             }
         }
 
+        void Panel_LTDC::copyRect(uint_fast16_t dst_x, uint_fast16_t dst_y,
+                                  uint_fast16_t w, uint_fast16_t h,
+                                  uint_fast16_t src_x, uint_fast16_t src_y)
+        {
+            _dma2d.wait();
+            /// 回転しても平行移動のままなので、物理座標の矩形の移動1回になる
+            uint_fast8_t r = _internal_rotation;
+            if (r)
+            {
+                if ((1u << r) & 0b10010110)
+                {
+                    src_y = _height - (src_y + h);
+                    dst_y = _height - (dst_y + h);
+                }
+                if (r & 2)
+                {
+                    src_x = _width - (src_x + w);
+                    dst_x = _width - (dst_x + w);
+                }
+                if (r & 1)
+                {
+                    std::swap(src_x, src_y);
+                    std::swap(dst_x, dst_y);
+                    std::swap(w, h);
+                }
+            }
+            _dirty.add(dst_x, dst_y, w, h);
+            size_t bytes = _write_bits >> 3;
+            size_t pitch = _stride() * bytes;
+            auto src = &_fb[src_y * pitch + src_x * bytes];
+            auto dst = &_fb[dst_y * pitch + dst_x * bytes];
+
+            /// DMA2Dは読み出しと書き込みの順序を保証しないため、重ならない場合のみ使う
+            int format = dma2d_format_from_bits(_write_bits);
+            if (format >= 0
+             && (src_x + w <= dst_x || dst_x + w <= src_x
+              || src_y + h <= dst_y || dst_y + h <= src_y)
+             && _dma2d.copy(dst, pitch, src, pitch, w, h, (dma2d_format_t)format))
+            {
+                return;
+            }
+
+            size_t len = w * bytes;
+            if (dst_y > src_y)
+            {
+                /// 下へ移動する場合は下の行から複写する
+                src += (h - 1) * pitch;
+                dst += (h - 1) * pitch;
+                do {
+                    kernels::move_bytes(dst, src, len);
+                    dst -= pitch;
+                    src -= pitch;
+                } while (--h);
+                return;
+            }
+            do {
+                kernels::move_bytes(dst, src, len);
+                dst += pitch;
+                src += pitch;
+            } while (--h);
+        }
+
+        int Panel_LTDC::_dma2d_native_format(void) const
+        {
+            /// DMA2Dの出力形式とLTDCの形式は 0〜2 で同じ値
+            return (_pixel_format <= LTDC_PIXEL_FORMAT_RGB565
+                 && dma2d_format_from_depth(_write_depth) >= 0)
+                 ? (int)_pixel_format : -1;
+        }
+
+        size_t Panel_LTDC::_rotated_index(uint_fast16_t x, uint_fast16_t y,
+                                          int32_t& dx, int32_t& dy)
+        {
+            int32_t bw = _stride();
+            uint_fast8_t r = _internal_rotation;
+            dx = 1;
+            dy = bw;
+            if ((1u << r) & 0b10010110)
+            {
+                y = _height - (y + 1);
+                dy = -dy;
+            }
+            if (r & 2)
+            {
+                x = _width - (x + 1);
+                dx = -dx;
+            }
+            if (r & 1)
+            {
+                /// 転置後は dx が行方向、dy が画素方向になる
+                std::swap(x, y);
+                dx *= bw;
+                dy /= bw;
+            }
+            return x + y * bw;
+        }
+
+        void Panel_LTDC::_rotate_rect(uint_fast16_t& x, uint_fast16_t& y,
+                                      uint_fast16_t& w, uint_fast16_t& h)
+        {
+            uint_fast8_t r = _internal_rotation;
+            if (r)
+            {
+                if ((1u << r) & 0b10010110)
+                {
+                    y = _height - (y + h);
+                }
+                if (r & 2)
+                {
+                    x = _width  - (x + w);
+                }
+                if (r & 1)
+                {
+                    std::swap(x, y);
+                    std::swap(w, h);
+                }
+            }
+        }
+
+        void Panel_LTDC::_mark_dirty(uint_fast16_t x, uint_fast16_t y,
+                                     uint_fast16_t w, uint_fast16_t h)
+        {
+            _rotate_rect(x, y, w, h);
+            _dirty.add(x, y, w, h);
+        }
+
+        void Panel_LTDC::_mark_line_dirty(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+        {
+            /// kernels::line と同じ手順で、長い方の軸を32画素ずつに分けた範囲の外接矩形を記録する。
+            /// 斜めの線で画面全体が記録されないようにするため
+            bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+            if (steep)
+            {
+                std::swap(x0, y0);
+                std::swap(x1, y1);
+            }
+            if (x0 > x1)
+            {
+                std::swap(x0, x1);
+                std::swap(y0, y1);
+            }
+            int32_t dx = x1 - x0;
+            int32_t dy = std::abs(y1 - y0);
+            int32_t ystep = y1 > y0 ? 1 : -1;
+            int32_t err = dx >> 1;
+            /// n 画素進んだ時点での短い方の軸の移動量
+            auto minor = [&](int32_t n)
+            {
+                int32_t a = n * dy - err;
+                return a > 0 ? (a + dx - 1) / dx : 0;
+            };
+            for (int32_t n = 0; n <= dx; n += 32)
+            {
+                int32_t e = std::min(n + 31, dx);
+                int32_t ya = y0 + ystep * minor(n);
+                int32_t yb = y0 + ystep * minor(e);
+                if (ya > yb) { std::swap(ya, yb); }
+                if (steep)
+                {
+                    _mark_dirty(ya, x0 + n, yb - ya + 1, e - n + 1);
+                }
+                else
+                {
+                    _mark_dirty(x0 + n, ya, e - n + 1, yb - ya + 1);
+                }
+            }
+        }
+
+        void Panel_LTDC::_copy_rect(uint8_t* dst, const uint8_t* src,
+                                    const dirty_rect_t& rect)
+        {
+            size_t bytes = _write_bits >> 3;
+            size_t pitch = _stride() * bytes;
+            size_t offset = rect.y * pitch + rect.x * bytes;
+            dst += offset;
+            src += offset;
+            int format = dma2d_format_from_bits(_write_bits);
+            if (format >= 0
+             && _dma2d.copy(dst, pitch, src, pitch, rect.w, rect.h,
+                            (dma2d_format_t)format))
+            {
+                return;
+            }
+            size_t len = rect.w * bytes;
+            uint_fast16_t h = rect.h;
+            do {
+                memcpy(dst, src, len);
+                dst += pitch;
+                src += pitch;
+            } while (--h);
+        }
+
         void Panel_LTDC::_rotate_pixelcopy(uint_fast16_t& x, uint_fast16_t& y,
                                             uint_fast16_t& w, uint_fast16_t& h,
                                             pixelcopy_t* param,
@@ -553,23 +1585,38 @@ namespace lgfx
         {
             LTDC_LayerCfgTypeDef layer_cfg;
 
-            layer_cfg.WindowX0 = 0;
-            layer_cfg.WindowX1 = _panel_timing.h.active;
-            layer_cfg.WindowY0 = 0;
-            layer_cfg.WindowY1 = _panel_timing.v.active;
-            layer_cfg.PixelFormat = LTDC_PIXEL_FORMAT_RGB565;
-            layer_cfg.FBStartAdress = (uint32_t)_fb;
-            layer_cfg.Alpha = 255;
+            uint_fast16_t x = std::min<uint_fast16_t>(_layer_x, _panel_timing.h.active - _view_w);
+            uint_fast16_t y = std::min<uint_fast16_t>(_layer_y, _panel_timing.v.active - _view_h);
+
+            layer_cfg.WindowX0 = x;
+            layer_cfg.WindowX1 = x + _view_w;
+            layer_cfg.WindowY0 = y;
+            layer_cfg.WindowY1 = y + _view_h;
+            layer_cfg.PixelFormat = _pixel_format;
+            layer_cfg.FBStartAdress = _scanout_address();
+            layer_cfg.Alpha = _layer_alpha;
             layer_cfg.Alpha0 = 0;
             layer_cfg.Backcolor.Blue = 0;
             layer_cfg.Backcolor.Green = 0;
             layer_cfg.Backcolor.Red = 0;
             layer_cfg.BlendingFactor1 = LTDC_BLENDING_FACTOR1_PAxCA;
             layer_cfg.BlendingFactor2 = LTDC_BLENDING_FACTOR2_PAxCA;
-            layer_cfg.ImageWidth = _panel_timing.h.active;
-            layer_cfg.ImageHeight = _panel_timing.v.active;
+            layer_cfg.ImageWidth = _view_w;
+            layer_cfg.ImageHeight = _view_h;
 
-            return HAL_LTDC_ConfigLayer(&_ltdc, &layer_cfg, 0) == HAL_OK;
+            if (HAL_LTDC_ConfigLayer(_hltdc, &layer_cfg, _layer) != HAL_OK)
+            {
+                return false;
+            }
+            _apply_clut();
+            _apply_color_key();
+            if (!_layer_visible)
+            {
+                __HAL_LTDC_LAYER_DISABLE(_hltdc, _layer);
+            }
+            /// ImageWidth は1行に表示する画素数。行の間隔は _reload() で指定する
+            _reload(LTDC_RELOAD_IMMEDIATE);
+            return true;
         }
     }
 }
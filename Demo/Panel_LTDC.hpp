@@ -2,14 +2,33 @@
 
 #include <stm32f7xx_hal_ltdc.h>
 #include <lgfx/v1/panel/Panel_Device.hpp>
+#include "DMA2D_Engine.hpp"
+#include "DirtyRegion.hpp"
 
 namespace lgfx
 {
     inline namespace v1
     {
+        class SpriteMask;
+
         struct Panel_LTDC : public Panel_Device
         {
         public:
+            /// fillSpans() に渡す1行の区間 (論理座標、クリップ済み)
+            struct span_t
+            {
+                uint16_t x;
+                uint16_t y;
+                uint16_t w;
+            };
+
+            /// drawPolylinePreclipped() に渡す頂点 (論理座標、クリップ済み)
+            struct point_t
+            {
+                int16_t x;
+                int16_t y;
+            };
+
             struct panel_timing_t
             {
                 struct info_t
@@ -26,7 +45,7 @@ namespace lgfx
             Panel_LTDC();
 
             bool init(bool use_reset) override;
-            void beginTransaction(void) override {}
+            void beginTransaction(void) override { waitDisplay(); }
             void endTransaction(void) override {}
 
             color_depth_t setColorDepth(color_depth_t depth) override;
@@ -36,33 +55,215 @@ namespace lgfx
             void setSleep(bool flg) override {}
             void setPowerSave(bool flg) override {}
 
-            void waitDisplay(void) override {}
-            bool displayBusy(void) override { return false; }
+            void display(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h) override;
+            void waitDisplay(void) override;
+            /// Vブランクでの反映待ちか、DMA2Dの転送中であれば true
+            bool displayBusy(void) override;
+
+            /// use_dma を指定した writeImage / writePixels は DMA2D のキューに積んで、完了を待たずに戻る。
+            /// 転送元の画像は waitDMA() するか dmaBusy() が false になるまで保持し、変更しないこと。
+            /// CPUで描画する関数は、先に積まれた転送の完了を待ってから描く
+            void initDMA(void) override {}
+            void waitDMA(void) override { _dma2d.wait(); }
+            bool dmaBusy(void) override { return _dma2d.busy(); }
 
             void writeBlock(uint32_t rawcolor, uint32_t len) override;
             void writePixels(pixelcopy_t* param, uint32_t len, bool use_dma) override;
             void drawPixelPreclipped(uint_fast16_t x, uint_fast16_t y, uint32_t rawcolor) override;
             void writeFillRectPreclipped(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h, uint32_t rawcolor) override;
             void writeImage(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h, pixelcopy_t* param, bool use_dma) override;
+            /// 高さ1の区間をまとめて塗る。回転の解釈は呼び出しごとに1回だけ行い、
+            /// 各区間は CPU で直接書く (DMA2D の起動より短い区間が多いため)
+            virtual void fillSpans(const span_t* spans, uint32_t count, uint32_t rawcolor);
+            /// fillSpans() 1回で渡す区間の数
+            static constexpr size_t span_batch = 64;
+            /// beginSpans() から endSpans() までの間、高さ1の writeFillRectPreclipped を溜めて
+            /// span_batch 個ずつ fillSpans() で書く。区間の求め方は呼び出し側 (LovyanGFX の図形) のまま変わらない
+            void beginSpans(void) { _span_capture = true; }
+            void endSpans(void)
+            {
+                _flush_spans();
+                _span_capture = false;
+            }
+            /// 両端を含む線を、フレームバッファのアドレスを直接進めて描く。両端は画面内であること
+            void drawLinePreclipped(uint_fast16_t x0, uint_fast16_t y0, uint_fast16_t x1, uint_fast16_t y1, uint32_t rawcolor)
+            {
+                point_t points[2] = { { (int16_t)x0, (int16_t)y0 }, { (int16_t)x1, (int16_t)y1 } };
+                drawPolylinePreclipped(points, 2, rawcolor);
+            }
+            /// points[0] から順に頂点を結ぶ線を描く。回転の解釈は呼び出しごとに1回だけ行う
+            virtual void drawPolylinePreclipped(const point_t* points, uint32_t count, uint32_t rawcolor);
+
+            /// 以下のアルファブレンドは、RGB565 の場合にフレームバッファ上で直接重ねる (読み出しと書き戻しをしない)。
+            /// それ以外の形式では何もしないので、先に canBlend() を確かめること。
+            /// alpha は 0〜255 を 5bit (0〜32) に丸めて使う。色は 0x00RRGGBB、画像・マスクの pitch は1行の画素数
+            bool canBlend(void) const { return _pixel_format == LTDC_PIXEL_FORMAT_RGB565; }
+            /// 矩形に同じ色を重ねる。2画素ずつまとめて処理する
+            void fillRectAlphaPreclipped(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h, uint32_t rgb888, uint8_t alpha);
+            /// 0xAARRGGBB の画像を画素ごとの alpha で重ねる
+            void blendImagePreclipped(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h, const uint32_t* argb8888, uint32_t pitch);
+            /// 8bit の alpha の配列をマスクとして rgb888 を重ねる (アンチエイリアスした文字・図形の縁など)
+            void blendMaskPreclipped(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h, const uint8_t* alpha, uint32_t pitch, uint32_t rgb888);
+
+            /// mask の (mask_x, mask_y) から w x h の範囲にある区間だけを (x, y) へ書く。
+            /// src は mask を作った画像の先頭 (表示と同じ画素形式)。画素のバイト数が表示と異なる mask は無視する
+            void writeImageMasked(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h,
+                                  const void* src, const SpriteMask& mask, uint_fast16_t mask_x, uint_fast16_t mask_y);
+
+            /// 拡大・縮小した画像 (回転しない pushImageRotateZoom・pushRotateZoom) を双線形補間で描く。
+            /// RGB565 で透過色を使わない場合のみ有効で、それ以外と既定は最近傍
+            void setBilinearScaling(bool enable) { _bilinear = enable; }
+            bool getBilinearScaling(void) const { return _bilinear; }
 
             uint32_t readCommand(uint_fast8_t cmd, uint_fast8_t index, uint_fast8_t len) override { return 0; }
             uint32_t readData(uint_fast8_t index, uint_fast8_t len) override { return 0; }
             void readRect(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h, void* dst, pixelcopy_t* param) override;
+            /// フレームバッファ内で矩形を移動する。重なっていてもよい (scrollRect も使う)
+            void copyRect(uint_fast16_t dst_x, uint_fast16_t dst_y, uint_fast16_t w, uint_fast16_t h, uint_fast16_t src_x, uint_fast16_t src_y) override;
 
             void setPanelTiming(const panel_timing_t &param) { _panel_timing = param; }
-            void setFrameBuffer(uint8_t * const framebuffer) { _fb = framebuffer; }
+            /// backbuffer を指定するとダブルバッファリングになり、display() で表示を切り替える
+            void setFrameBuffer(uint8_t * const framebuffer, uint8_t * const backbuffer = nullptr)
+            {
+                _fb_disp = framebuffer;
+                _fb = backbuffer ? backbuffer : framebuffer;
+            }
+            /// 1行のバイト数。0 (既定) の場合は panel_width の画素を詰めて並べる。
+            /// 32の倍数にすると各行の先頭がキャッシュラインとSDRAMのバースト境界に揃う。
+            /// 画素のバイト数の倍数に切り捨て、1行に足りない場合は詰めた幅になる。
+            /// フレームバッファは getLinePitch() * panel_height バイト必要
+            virtual void setLinePitch(uint32_t bytes);
+            uint32_t getLinePitch(void) const { return _stride() * (_write_bits >> 3); }
+            /// config の memory_width / memory_height が表示する大きさより大きい場合、
+            /// その大きさの仮想画面に描画し、setScroll() で指定した位置から表示する
+            uint_fast16_t getViewWidth(void) const { return _view_w; }
+            uint_fast16_t getViewHeight(void) const { return _view_h; }
+            /// 表示を開始する仮想画面上の位置 (物理座標)。画素の複写はせず、次のVブランクで切り替わる
+            void setScroll(uint_fast16_t x, uint_fast16_t y);
+            uint_fast16_t getScrollX(void) const { return _scroll_x; }
+            uint_fast16_t getScrollY(void) const { return _scroll_y; }
+            /// display() 後、表示した内容を新しい描画先へ複写する (部分更新用)
+            void setCopyForward(bool enable) { _copy_forward = enable; }
+            bool isDoubleBuffered(void) const { return _fb != _fb_disp; }
+
+            /// setColorDepth で選べない LTDC_PIXEL_FORMAT_AL44 / AL88 などを直接指定する。
+            /// AL44 は 8bit、AL88 は 16bit の生の値として描画される
+            virtual void setPixelFormat(uint32_t ltdc_format);
+            uint32_t getPixelFormat(void) const { return _pixel_format; }
+
+            /// L8 / AL44 用のCLUT (0x00RRGGBB)。未指定時は色深度に合わせたものを使う。
+            /// init() 前に指定する場合、配列は init() まで保持しておくこと
+            void setCLUT(const uint32_t* rgb888, size_t count);
+
+            /// base (layer 0) のLTDCを共有し、指定したレイヤーに描画する。
+            /// init() は base の init() の後に呼ぶこと
+            void setBaseLayer(Panel_LTDC* base, uint_fast8_t layer = 1);
+            uint_fast8_t getLayer(void) const { return _layer; }
+
+            /// レイヤーの表示位置と大きさ (画面座標)。w, h が 0 の場合は画面全体。init() 前に指定する
+            void setLayerWindow(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h);
+            /// 表示位置を変更する。画面からはみ出さないよう補正し、次のVブランクで反映する
+            void moveLayer(uint_fast16_t x, uint_fast16_t y);
+            /// 以下も init() 前に指定した場合は init() で、以降は次のVブランクで反映する
+            void setLayerAlpha(uint8_t alpha);
+            /// 0x00RRGGBB と一致する画素を透過する
+            void setColorKey(uint32_t rgb888);
+            void disableColorKey(void);
+            void setLayerVisible(bool visible);
+
+            DMA2D_Engine& dma2d(void) { return _dma2d; }
+
+            /// 前回 clearDirty() してから描画された領域 (物理座標)。
+            /// setCopyForward(true) の場合は display() で複写した後にクリアされる
+            size_t getDirtyRects(dirty_rect_t* rects, size_t max) const { return _dirty.getRects(rects, max); }
+            void clearDirty(void) { _dirty.clear(); }
 
         protected:
             LTDC_HandleTypeDef _ltdc;
+            LTDC_HandleTypeDef* _hltdc;   // 自身の _ltdc か base の _ltdc
+            Panel_LTDC* _base = nullptr;
+            uint8_t _layer = 0;
             panel_timing_t _panel_timing;
+            DMA2D_Engine _dma2d;
+            DirtyRegion _dirty;
+
+            uint16_t _layer_x = 0;
+            uint16_t _layer_y = 0;
+            uint16_t _layer_w = 0;
+            uint16_t _layer_h = 0;
+            uint16_t _view_w = 0;
+            uint16_t _view_h = 0;
+            uint16_t _scroll_x = 0;
+            uint16_t _scroll_y = 0;
+            uint8_t _layer_alpha = 255;
+            bool _layer_visible = true;
+            bool _use_color_key = false;
+            uint32_t _color_key = 0;
+
+            uint32_t _pixel_format = LTDC_PIXEL_FORMAT_RGB565;
+            const uint32_t* _clut = nullptr;
+            size_t _clut_size = 0;
 
-            uint8_t * _fb = nullptr;
+            uint8_t * _fb = nullptr;      // 描画先
+            uint8_t * _fb_disp = nullptr; // 表示中
+            bool _copy_forward = false;
+            uint32_t _line_pitch = 0;
             int32_t _xpos = 0;
             int32_t _ypos = 0;
+            bool _bilinear = false;
+
+            span_t _spans[span_batch];
+            uint32_t _span_count = 0;
+            uint32_t _span_color = 0;
+            bool _span_capture = false;
+
+            /// beginSpans() の間の高さ1の塗りつぶしを溜める。溜めた場合は true
+            bool _capture_span(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h, uint32_t rawcolor)
+            {
+                if (!_span_capture || h != 1) return false;
+                if (_span_count && (_span_color != rawcolor || _span_count == span_batch))
+                {
+                    _flush_spans();
+                }
+                _span_color = rawcolor;
+                _spans[_span_count++] = { (uint16_t)x, (uint16_t)y, (uint16_t)w };
+                return true;
+            }
+            void _flush_spans(void)
+            {
+                if (!_span_count) return;
+                uint32_t count = _span_count;
+                _span_count = 0;
+                fillSpans(_spans, count, _span_color);
+            }
+
+            /// 1行の画素数 (フレームバッファ上の行の間隔)
+            uint32_t _stride(void) const
+            {
+                uint32_t stride = _line_pitch / (_write_bits >> 3);
+                return stride > _cfg.panel_width ? stride : _cfg.panel_width;
+            }
 
             bool _setup_ltdc_clock(void);
             bool _init_ltdc(void);
             bool _init_ltdc_layer(void);
+            void _set_format(uint32_t format, color_depth_t depth);
+            /// LTDC の形式に対応する色深度。対応しない形式は RGB565 にする
+            static color_depth_t _format_depth(uint32_t& format);
+            /// 表示する範囲の大きさ (setLayerWindow() の指定か、パネル全体)
+            void _view_size(uint16_t& w, uint16_t& h) const;
+            void _apply_clut(void);
+            void _apply_color_key(void);
+            uintptr_t _scanout_address(void) const;
+            void _reload(uint32_t reload_type);
+            int _dma2d_native_format(void) const;
+            size_t _rotated_index(uint_fast16_t x, uint_fast16_t y, int32_t& dx, int32_t& dy);
+            /// 論理座標の矩形を物理座標に変換する
+            void _rotate_rect(uint_fast16_t& x, uint_fast16_t& y, uint_fast16_t& w, uint_fast16_t& h);
+            void _mark_dirty(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h);
+            void _mark_line_dirty(int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+            void _copy_rect(uint8_t* dst, const uint8_t* src, const dirty_rect_t& rect);
+            bool _write_scaled(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h, pixelcopy_t* param);
             void _rotate_pixelcopy(uint_fast16_t& x, uint_fast16_t& y, uint_fast16_t& w, uint_fast16_t& h, pixelcopy_t* param, uint32_t& nextx, uint32_t& nexty);
         };
     }
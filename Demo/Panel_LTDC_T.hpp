@@ -0,0 +1,242 @@
+#pragma once
+
+#include "Panel_LTDC.hpp"
+#include "pixel_kernels.hpp"
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        /// 描画先の大きさ・色深度・1行の画素数をコンパイル時に固定した Panel_LTDC。
+        /// 画素の書き込み・矩形の塗りつぶし・fillSpans()・線を回転ごとに実体化し、setRotation() で表から選ぶ。
+        /// アドレスの計算は定数に畳み込まれ、内側のループから回転の分岐がなくなる。
+        /// W x H は仮想画面を含めた描画先の大きさで、表示する範囲はこれ以下であること。
+        /// setColorDepth()・setLinePitch() は Depth・Pitch のまま変わらず、setPixelFormat() は Depth と同じ色深度の形式だけを受け付ける
+        template <uint16_t W, uint16_t H,
+                  color_depth_t Depth = color_depth_t::rgb565_2Byte,
+                  uint16_t Pitch = W>
+        struct Panel_LTDC_T : public Panel_LTDC
+        {
+        public:
+            static_assert(Pitch >= W, "Pitch must not be less than W");
+            static constexpr uint_fast8_t bytes = (Depth & color_depth_t::bit_mask) >> 3;
+            static_assert(bytes >= 1 && bytes <= 4, "unsupported color depth");
+            using pixel_t = typename kernels::pixel_type<bytes>::type;
+
+            Panel_LTDC_T()
+            {
+                _cfg.memory_width  = _cfg.panel_width  = W;
+                _cfg.memory_height = _cfg.panel_height = H;
+                Panel_LTDC::setColorDepth(Depth);
+                Panel_LTDC::setLinePitch(Pitch * bytes);
+                _kernel = _kernels(0);
+            }
+
+            bool init(bool use_reset) override
+            {
+                /// 表示する範囲が W x H を超えると描画先の大きさが変わり、定数の前提が崩れるので、LTDC を設定する前に失敗させる
+                uint16_t view_w, view_h;
+                _view_size(view_w, view_h);
+                if (view_w > W || view_h > H)
+                {
+                    return false;
+                }
+                _cfg.memory_width  = W;
+                _cfg.memory_height = H;
+                return Panel_LTDC::init(use_reset);
+            }
+
+            color_depth_t setColorDepth(color_depth_t) override
+            {
+                return Panel_LTDC::setColorDepth(Depth);
+            }
+
+            void setLinePitch(uint32_t) override
+            {
+                Panel_LTDC::setLinePitch(Pitch * bytes);
+            }
+
+            void setPixelFormat(uint32_t ltdc_format) override
+            {
+                if (_format_depth(ltdc_format) == Depth)
+                {
+                    Panel_LTDC::setPixelFormat(ltdc_format);
+                }
+            }
+
+            void setRotation(uint_fast8_t r) override
+            {
+                Panel_LTDC::setRotation(r);
+                _kernel = _kernels(_internal_rotation);
+            }
+
+            void drawPixelPreclipped(uint_fast16_t x, uint_fast16_t y, uint32_t rawcolor) override
+            {
+                _kernel->pixel(this, x, y, rawcolor);
+            }
+            void writeFillRectPreclipped(uint_fast16_t x, uint_fast16_t y, uint_fast16_t w, uint_fast16_t h, uint32_t rawcolor) override
+            {
+                if (_capture_span(x, y, w, h, rawcolor)) return;
+                _kernel->fill(this, x, y, w, h, rawcolor);
+            }
+            void fillSpans(const span_t* spans, uint32_t count, uint32_t rawcolor) override
+            {
+                _kernel->spans(this, spans, count, rawcolor);
+            }
+            void drawPolylinePreclipped(const point_t* points, uint32_t count, uint32_t rawcolor) override
+            {
+                _kernel->polyline(this, points, count, rawcolor);
+            }
+
+        private:
+            static constexpr int dma2d_format = bytes == 4 ? dma2d_argb8888
+                                              : bytes == 3 ? dma2d_rgb888
+                                              : bytes == 2 ? dma2d_rgb565
+                                              : -1;
+
+            struct kernel_t
+            {
+                void (*pixel)(Panel_LTDC_T*, uint_fast16_t, uint_fast16_t, uint32_t);
+                void (*fill)(Panel_LTDC_T*, uint_fast16_t, uint_fast16_t, uint_fast16_t, uint_fast16_t, uint32_t);
+                void (*spans)(Panel_LTDC_T*, const span_t*, uint32_t, uint32_t);
+                void (*polyline)(Panel_LTDC_T*, const point_t*, uint32_t, uint32_t);
+            };
+
+            const kernel_t* _kernel;
+
+            /// 回転 R での論理座標から物理座標への変換 (Panel_LTDC::_rotated_index と同じ規則)
+            template <uint_fast8_t R>
+            struct rot_t
+            {
+                static constexpr bool swap   = R & 1;
+                static constexpr bool flip_x = R & 2;
+                static constexpr bool flip_y = (1u << R) & 0b10010110;
+                /// 論理座標での幅・高さ
+                static constexpr int32_t lw = swap ? H : W;
+                static constexpr int32_t lh = swap ? W : H;
+                /// 論理座標の x・y を1進めたときの画素の移動量と、原点の位置
+                static constexpr int32_t step_x = (swap ? Pitch : 1) * (flip_x ? -1 : 1);
+                static constexpr int32_t step_y = (swap ? 1 : Pitch) * (flip_y ? -1 : 1);
+                static constexpr int32_t origin = (flip_x ? (lw - 1) * (swap ? Pitch : 1) : 0)
+                                                + (flip_y ? (lh - 1) * (swap ? 1 : Pitch) : 0);
+
+                static void pixel(Panel_LTDC_T* p, uint_fast16_t x, uint_fast16_t y, uint32_t rawcolor)
+                {
+                    p->_dma2d.wait();
+                    if (flip_y) { y = lh - (y + 1); }
+                    if (flip_x) { x = lw - (x + 1); }
+                    if (swap) { std::swap(x, y); }
+                    p->_dirty.add(x, y);
+                    kernels::store((pixel_t*)p->_fb + x + y * Pitch, rawcolor);
+
+                    if (!p->getStartCount())
+                    {
+                        p->waitDisplay();
+                        if (p->_auto_display)
+                        {
+                            p->display(x, y, 1, 1);
+                        }
+                    }
+                }
+
+                static void fill(Panel_LTDC_T* p, uint_fast16_t x, uint_fast16_t y,
+                                 uint_fast16_t w, uint_fast16_t h, uint32_t rawcolor)
+                {
+                    if (flip_y) { y = lh - (y + h); }
+                    if (flip_x) { x = lw - (x + w); }
+                    if (swap) { std::swap(x, y); std::swap(w, h); }
+                    p->_dirty.add(x, y, w, h);
+                    auto dst = (pixel_t*)p->_fb + x + y * Pitch;
+                    if (dma2d_format >= 0
+                     && p->_dma2d.fill(dst, Pitch * bytes, w, h, rawcolor, (dma2d_format_t)dma2d_format))
+                    {
+                        return;
+                    }
+                    p->_dma2d.wait();
+                    if (w == Pitch)
+                    {
+                        kernels::fill(dst, rawcolor, bytes, (size_t)w * h);
+                        return;
+                    }
+                    do {
+                        kernels::fill(dst, rawcolor, bytes, w);
+                        dst += Pitch;
+                    } while (--h);
+                }
+
+                static void spans(Panel_LTDC_T* p, const span_t* spans, uint32_t count, uint32_t rawcolor)
+                {
+                    if (!count) return;
+                    p->_dma2d.wait();
+                    auto fb = (pixel_t*)p->_fb + origin;
+                    uint_fast16_t l = ~0u, r = 0, t = ~0u, b = 0;
+                    for (uint32_t i = 0; i < count; ++i)
+                    {
+                        uint_fast16_t x = spans[i].x;
+                        uint_fast16_t y = spans[i].y;
+                        uint_fast16_t w = spans[i].w;
+                        if (!w) continue;
+                        auto dst = fb + (int32_t)x * step_x + (int32_t)y * step_y;
+                        if (!swap)
+                        {
+                            if (flip_x) { dst -= w - 1; }
+                            kernels::fill(dst, rawcolor, bytes, w);
+                        }
+                        else
+                        {
+                            uint_fast16_t n = w;
+                            do {
+                                kernels::store(dst, rawcolor);
+                                dst += step_x;
+                            } while (--n);
+                        }
+                        if (l > x) { l = x; }
+                        if (r < x + w) { r = x + w; }
+                        if (t > y) { t = y; }
+                        if (b < y) { b = y; }
+                    }
+                    if (l < r)
+                    {
+                        /// 物理座標への変換は最後に1回だけ
+                        uint_fast16_t dx = l, dy = t, dw = r - l, dh = b - t + 1;
+                        if (flip_y) { dy = lh - (dy + dh); }
+                        if (flip_x) { dx = lw - (dx + dw); }
+                        if (swap) { std::swap(dx, dy); std::swap(dw, dh); }
+                        p->_dirty.add(dx, dy, dw, dh);
+                    }
+                }
+
+                static void polyline(Panel_LTDC_T* p, const point_t* points, uint32_t count, uint32_t rawcolor)
+                {
+                    if (!count) return;
+                    p->_dma2d.wait();
+                    auto fb = (pixel_t*)p->_fb + origin;
+                    if (count == 1)
+                    {
+                        kernels::store(fb + points[0].x * step_x + points[0].y * step_y, rawcolor);
+                        p->_mark_line_dirty(points[0].x, points[0].y, points[0].x, points[0].y);
+                        return;
+                    }
+                    for (uint32_t i = 1; i < count; ++i)
+                    {
+                        kernels::line(fb, step_x, step_y, points[i - 1].x, points[i - 1].y,
+                                      points[i].x, points[i].y, rawcolor);
+                        p->_mark_line_dirty(points[i - 1].x, points[i - 1].y, points[i].x, points[i].y);
+                    }
+                }
+
+                static constexpr kernel_t kernel(void) { return { &pixel, &fill, &spans, &polyline }; }
+            };
+
+            static const kernel_t* _kernels(uint_fast8_t r)
+            {
+                static constexpr kernel_t table[8] =
+                {
+                    rot_t<0>::kernel(), rot_t<1>::kernel(), rot_t<2>::kernel(), rot_t<3>::kernel(),
+                    rot_t<4>::kernel(), rot_t<5>::kernel(), rot_t<6>::kernel(), rot_t<7>::kernel(),
+                };
+                return &table[r & 7];
+            }
+        };
+    }
+}
@@ -0,0 +1,316 @@
+#include "SDRAM_Arena.hpp"
+#include <string.h>
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        static size_t align_up(size_t v, size_t align)
+        {
+            return (v + align - 1) & ~(align - 1);
+        }
+
+        /// align の 0 は 1 として扱う。2のべき乗でなければ false
+        static bool check_align(size_t& align)
+        {
+            if (!align) { align = 1; }
+            return !(align & (align - 1));
+        }
+
+        void SDRAM_Arena::init(void* base, size_t size)
+        {
+            _base = (uint8_t*)base;
+            _size = size;
+            _blocks[0] = { 0, (uint32_t)size, false };
+            _count = 1;
+            _used = 0;
+            _peak = 0;
+            _allocs = 0;
+            _frees = 0;
+            _failures = 0;
+        }
+
+        void* SDRAM_Arena::alloc(size_t size, size_t align)
+        {
+            void* p = nullptr;
+            if (size && check_align(align))
+            {
+                size = align_up(size, 4);
+                if (_bank_size && ~_default_banks)
+                {
+                    p = _alloc_banks(size, align, _default_banks);
+                }
+                if (p == nullptr)
+                {
+                    p = _alloc_range(size, align, 0, _size);
+                }
+            }
+            if (p == nullptr) { ++_failures; }
+            return p;
+        }
+
+        void* SDRAM_Arena::allocInBanks(size_t size, uint32_t bank_mask, size_t align)
+        {
+            void* p = nullptr;
+            if (size && check_align(align))
+            {
+                size = align_up(size, 4);
+                p = _bank_size ? _alloc_banks(size, align, bank_mask)
+                               : _alloc_range(size, align, 0, _size);
+            }
+            if (p == nullptr) { ++_failures; }
+            return p;
+        }
+
+        void* SDRAM_Arena::_alloc_banks(size_t size, size_t align, uint32_t bank_mask)
+        {
+            /// 連続したバンクはまとめて1つの範囲として探す
+            size_t count = getBankCount();
+            for (size_t i = 0; i < count && i < 32; ++i)
+            {
+                if (!(bank_mask & (1u << i))) continue;
+                size_t j = i + 1;
+                while (j < count && j < 32 && (bank_mask & (1u << j))) { ++j; }
+                size_t hi = j * _bank_size;
+                void* p = _alloc_range(size, align, i * _bank_size, hi < _size ? hi : _size);
+                if (p) return p;
+                i = j;
+            }
+            return nullptr;
+        }
+
+        void* SDRAM_Arena::_alloc_range(size_t size, size_t align, size_t lo, size_t hi)
+        {
+            for (uint32_t i = 0; i < _count; ++i)
+            {
+                auto& b = _blocks[i];
+                if (b.used || b.size < size) continue;
+                if (b.offset + b.size <= lo) continue;
+                if (b.offset >= hi) break;
+
+                size_t begin = b.offset < lo ? lo : b.offset;
+                size_t start = align_up((uintptr_t)_base + begin, align) - (uintptr_t)_base;
+                size_t end = b.offset + b.size < hi ? b.offset + b.size : hi;
+                if (start + size > end) continue;
+
+                size_t pad = start - b.offset;
+                size_t rest = b.size - pad - size;
+                if (_count + (pad ? 1 : 0) + (rest ? 1 : 0) > max_blocks) break;
+
+                if (pad)
+                {
+                    /// 先頭の余りは空きブロックとして残す
+                    b.size = pad;
+                    _insert(++i, { (uint32_t)start, (uint32_t)size, true });
+                }
+                else
+                {
+                    b.size = size;
+                    b.used = true;
+                }
+                if (rest)
+                {
+                    _insert(i + 1, { (uint32_t)(start + size), (uint32_t)rest, false });
+                }
+                _used += size;
+                if (_peak < _used) { _peak = _used; }
+                ++_allocs;
+                return _base + start;
+            }
+            return nullptr;
+        }
+
+        void SDRAM_Arena::free(void* ptr)
+        {
+            int i = _find(ptr);
+            if (i < 0) return;
+
+            _blocks[i].used = false;
+            _used -= _blocks[i].size;
+            ++_frees;
+
+            /// 前後の空きブロックとまとめる
+            if ((uint32_t)i + 1 < _count && !_blocks[i + 1].used)
+            {
+                _blocks[i].size += _blocks[i + 1].size;
+                _erase(i + 1);
+            }
+            if (i > 0 && !_blocks[i - 1].used)
+            {
+                _blocks[i - 1].size += _blocks[i].size;
+                _erase(i);
+            }
+        }
+
+        size_t SDRAM_Arena::getSize(const void* ptr) const
+        {
+            int i = _find(ptr);
+            return i < 0 ? 0 : _blocks[i].size;
+        }
+
+        sdram_arena_stats_t SDRAM_Arena::getStats(void) const
+        {
+            sdram_arena_stats_t s;
+            s.total = _size;
+            s.used = _used;
+            s.peak = _peak;
+            s.largest_free = 0;
+            for (uint32_t i = 0; i < _count; ++i)
+            {
+                if (!_blocks[i].used && s.largest_free < _blocks[i].size)
+                {
+                    s.largest_free = _blocks[i].size;
+                }
+            }
+            s.blocks = _count;
+            s.allocs = _allocs;
+            s.frees = _frees;
+            s.failures = _failures;
+            return s;
+        }
+
+        int SDRAM_Arena::_find(const void* ptr) const
+        {
+            if (!contains(ptr)) return -1;
+            uint32_t offset = (const uint8_t*)ptr - _base;
+            /// ブロックはアドレス順に並んでいる
+            uint32_t lo = 0, hi = _count;
+            while (lo < hi)
+            {
+                uint32_t mid = (lo + hi) >> 1;
+                if (_blocks[mid].offset < offset) { lo = mid + 1; }
+                else { hi = mid; }
+            }
+            return (lo < _count && _blocks[lo].offset == offset && _blocks[lo].used) ? (int)lo : -1;
+        }
+
+        void SDRAM_Arena::_insert(uint32_t index, const block_t& block)
+        {
+            memmove(&_blocks[index + 1], &_blocks[index], (_count - index) * sizeof(block_t));
+            _blocks[index] = block;
+            ++_count;
+        }
+
+        void SDRAM_Arena::_erase(uint32_t index)
+        {
+            --_count;
+            memmove(&_blocks[index], &_blocks[index + 1], (_count - index) * sizeof(block_t));
+        }
+
+//----------------------------------------------------------------------------
+
+        bool SDRAM_Pool::init(SDRAM_Arena& arena, size_t block_size, size_t count, size_t align)
+        {
+            release();
+            if (!count || !check_align(align))
+            {
+                return false;
+            }
+            block_size = align_up(block_size < sizeof(void*) ? sizeof(void*) : block_size, align);
+            auto region = (uint8_t*)arena.alloc(block_size * count, align);
+            if (region == nullptr)
+            {
+                return false;
+            }
+            _arena = &arena;
+            _region = region;
+            _block_size = block_size;
+            _capacity = count;
+            _available = count;
+            _peak = 0;
+
+            _free_list = nullptr;
+            for (size_t i = count; i; --i)
+            {
+                void* block = region + (i - 1) * block_size;
+                *(void**)block = _free_list;
+                _free_list = block;
+            }
+            return true;
+        }
+
+        void SDRAM_Pool::release(void)
+        {
+            if (_arena)
+            {
+                _arena->free(_region);
+            }
+            _arena = nullptr;
+            _region = nullptr;
+            _free_list = nullptr;
+            _capacity = 0;
+            _available = 0;
+        }
+
+        void* SDRAM_Pool::alloc(void)
+        {
+            void* block = _free_list;
+            if (block)
+            {
+                _free_list = *(void**)block;
+                --_available;
+                if (_peak < _capacity - _available) { _peak = _capacity - _available; }
+            }
+            return block;
+        }
+
+        void SDRAM_Pool::free(void* ptr)
+        {
+            /// このプールのブロックの先頭でなければ何もしない
+            auto p = (uint8_t*)ptr;
+            if (p < _region || p >= _region + _block_size * _capacity
+             || (size_t)(p - _region) % _block_size)
+            {
+                return;
+            }
+            *(void**)ptr = _free_list;
+            _free_list = ptr;
+            ++_available;
+        }
+
+//----------------------------------------------------------------------------
+
+        bool SDRAM_FrameArena::init(SDRAM_Arena& arena, size_t size)
+        {
+            release();
+            _region = (uint8_t*)arena.alloc(size);
+            if (_region == nullptr)
+            {
+                return false;
+            }
+            _arena = &arena;
+            _capacity = size;
+            _offset = 0;
+            _peak = 0;
+            return true;
+        }
+
+        void SDRAM_FrameArena::release(void)
+        {
+            if (_arena)
+            {
+                _arena->free(_region);
+            }
+            _arena = nullptr;
+            _region = nullptr;
+            _capacity = 0;
+            _offset = 0;
+        }
+
+        void* SDRAM_FrameArena::alloc(size_t size, size_t align)
+        {
+            if (!check_align(align))
+            {
+                return nullptr;
+            }
+            size_t start = align_up((uintptr_t)_region + _offset, align) - (uintptr_t)_region;
+            if (_region == nullptr || start + size > _capacity)
+            {
+                return nullptr;
+            }
+            _offset = start + size;
+            if (_peak < _offset) { _peak = _offset; }
+            return _region + start;
+        }
+    }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        struct sdram_arena_stats_t
+        {
+            size_t total;         // 管理している領域の大きさ
+            size_t used;          // 確保中の合計
+            size_t peak;          // used の最大値
+            size_t largest_free;  // 確保できる最大の連続領域 (アラインメント前)
+            uint32_t blocks;      // 使用中・空きを合わせたブロック数
+            uint32_t allocs;
+            uint32_t frees;
+            uint32_t failures;
+        };
+
+        /// SDRAM などの大きな領域を切り分ける。
+        /// 管理情報は内部のテーブルに持ち、SDRAM 側には書き込まない
+        class SDRAM_Arena
+        {
+        public:
+            static constexpr size_t max_blocks = 64;
+            /// Cortex-M7 の D-cache のライン長。DMA2D とキャッシュ操作の単位を揃える
+            static constexpr size_t default_align = 32;
+
+            void init(void* base, size_t size);
+
+            /// SDRAM の内部バンクの大きさ。0 (既定) の場合はバンクを考慮しない。
+            /// STM32F746G-DISCO の SDRAM (行12bit・列8bit・16bit幅) ではアドレスの bit22:21 がバンクなので 2MiB
+            void setBankSize(size_t bank_size) { _bank_size = bank_size; }
+            size_t getBankSize(void) const { return _bank_size; }
+            size_t getBankCount(void) const { return _bank_size ? (_size + _bank_size - 1) / _bank_size : 1; }
+            int getBank(const void* ptr) const
+            {
+                return (_bank_size && contains(ptr)) ? (int)(((const uint8_t*)ptr - _base) / _bank_size) : -1;
+            }
+            /// alloc() が優先して使うバンク (bit0 がバンク0)。
+            /// 表示中のフレームバッファがあるバンクを外しておくと、LTDC の読み出しとの行の衝突が減る
+            void setDefaultBanks(uint32_t bank_mask) { _default_banks = bank_mask; }
+
+            /// 空きの中で最も手前のものから確保する (first fit)。
+            /// setDefaultBanks() のバンクに空きがない場合は他のバンクから確保する。失敗時は nullptr。
+            /// align は2のべき乗 (0 は 1 とみなす)
+            void* alloc(size_t size, size_t align = default_align);
+            /// bank_mask のバンクの中だけから確保する
+            void* allocInBanks(size_t size, uint32_t bank_mask, size_t align = default_align);
+            void free(void* ptr);
+
+            bool contains(const void* ptr) const
+            {
+                return (const uint8_t*)ptr >= _base && (const uint8_t*)ptr < _base + _size;
+            }
+            /// alloc() で返した領域の大きさ。見つからない場合は 0
+            size_t getSize(const void* ptr) const;
+
+            sdram_arena_stats_t getStats(void) const;
+            void resetPeak(void) { _peak = _used; }
+
+        private:
+            struct block_t
+            {
+                uint32_t offset;
+                uint32_t size;
+                bool used;
+            };
+
+            block_t _blocks[max_blocks];
+            uint32_t _count = 0;
+            uint8_t* _base = nullptr;
+            size_t _size = 0;
+            size_t _bank_size = 0;
+            uint32_t _default_banks = ~0u;
+            size_t _used = 0;
+            size_t _peak = 0;
+            uint32_t _allocs = 0;
+            uint32_t _frees = 0;
+            uint32_t _failures = 0;
+
+            void* _alloc_range(size_t size, size_t align, size_t lo, size_t hi);
+            void* _alloc_banks(size_t size, size_t align, uint32_t bank_mask);
+            int _find(const void* ptr) const;
+            void _insert(uint32_t index, const block_t& block);
+            void _erase(uint32_t index);
+        };
+
+        /// 同じ大きさのブロック (スプライト・グリフのタイルなど) を払い出す。
+        /// 空きブロックは先頭に次の空きへのポインタを持つ
+        class SDRAM_Pool
+        {
+        public:
+            bool init(SDRAM_Arena& arena, size_t block_size, size_t count,
+                      size_t align = SDRAM_Arena::default_align);
+            /// 領域を arena へ返す
+            void release(void);
+
+            void* alloc(void);
+            /// このプールのブロックでないポインタは無視する
+            void free(void* ptr);
+
+            size_t getBlockSize(void) const { return _block_size; }
+            size_t getCapacity(void) const { return _capacity; }
+            size_t getAvailable(void) const { return _available; }
+            size_t getPeak(void) const { return _peak; }
+
+        private:
+            SDRAM_Arena* _arena = nullptr;
+            uint8_t* _region = nullptr;
+            void* _free_list = nullptr;
+            size_t _block_size = 0;
+            size_t _capacity = 0;
+            size_t _available = 0;
+            size_t _peak = 0;
+        };
+
+        /// 1フレームの間だけ使う作業領域。alloc() は先頭から順に切り出し、reset() でまとめて解放する
+        class SDRAM_FrameArena
+        {
+        public:
+            bool init(SDRAM_Arena& arena, size_t size);
+            void release(void);
+
+            void* alloc(size_t size, size_t align = 4);
+            void reset(void) { _offset = 0; }
+
+            size_t getCapacity(void) const { return _capacity; }
+            size_t getUsed(void) const { return _offset; }
+            size_t getPeak(void) const { return _peak; }
+
+        private:
+            SDRAM_Arena* _arena = nullptr;
+            uint8_t* _region = nullptr;
+            size_t _capacity = 0;
+            size_t _offset = 0;
+            size_t _peak = 0;
+        };
+    }
+}
@@ -0,0 +1,232 @@
+#include "SDRAM_DMA.hpp"
+#include <stm32f7xx_hal_rcc.h>
+#include <string.h>
+
+#if defined (DMA2)
+#include "stm32746g_discovery_sdram.h"
+#endif
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+#if defined (DMA2)
+        /// 完了割り込みとキューを取り合う間は割り込みを止める
+        struct irq_lock_t
+        {
+            uint32_t primask = __get_PRIMASK();
+            irq_lock_t(void) { __disable_irq(); }
+            ~irq_lock_t(void) { __set_PRIMASK(primask); }
+        };
+
+        struct SDRAM_DMA_Device_HW : public ISDRAM_DMA_Device
+        {
+            bool start(SDRAM_DMA* owner, const void* src, void* dst, uint32_t words) override
+            {
+                _owner = owner;
+                _dst = dst;
+                _size = words << 2;
+                /// D-cache が有効な場合、転送中に dst の行が読み込まれたり、同じ行の他の値と一緒に
+                /// 書き戻されたりしないよう、行に揃っていない dst は CPU で写して poll() で完了を通知する
+                if (!_dcache_line_aligned(dst, _size))
+                {
+                    memcpy(dst, src, _size);
+                    _cpu_done = true;
+                    return true;
+                }
+                _clean(src, _size);
+                _clean_invalidate(dst, _size);
+                return BSP_SDRAM_DMA_Start((uint32_t)src, (uint32_t)dst, words) == SDRAM_OK;
+            }
+
+            void poll(void) override
+            {
+                if (!_cpu_done) return;
+                _cpu_done = false;
+                _owner->complete(false);
+            }
+
+            /// 行に揃った dst が分割の途中で揃わなくならないよう、32バイトの倍数にする
+            uint32_t maxWords(void) const override { return 0xFFF8; }
+
+            static void callback(uint8_t status)
+            {
+                if (_owner)
+                {
+                    /// 転送中に投機的に読み込まれた dst の行を捨ててから完了を通知する
+                    _invalidate(_dst, _size);
+                    _owner->complete(status != SDRAM_OK);
+                }
+            }
+
+        private:
+            static SDRAM_DMA* _owner;
+            static void* _dst;
+            static size_t _size;
+            static volatile bool _cpu_done;
+
+            static bool _dcache_line_aligned(const void* addr, size_t size)
+            {
+#if defined (__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+                if (SCB->CCR & SCB_CCR_DC_Msk)
+                {
+                    return !(((uintptr_t)addr | size) & 31);
+                }
+#endif
+                return true;
+            }
+
+            static void _clean(const void* addr, size_t size)
+            {
+#if defined (__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+                if (SCB->CCR & SCB_CCR_DC_Msk)
+                {
+                    uint32_t start = (uint32_t)addr & ~31u;
+                    uint32_t end   = ((uint32_t)addr + size + 31) & ~31u;
+                    SCB_CleanDCache_by_Addr((uint32_t*)start, end - start);
+                }
+#endif
+            }
+
+            static void _clean_invalidate(const void* addr, size_t size)
+            {
+#if defined (__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+                if (SCB->CCR & SCB_CCR_DC_Msk)
+                {
+                    SCB_CleanInvalidateDCache_by_Addr((uint32_t*)addr, size);
+                }
+#endif
+            }
+
+            static void _invalidate(void* addr, size_t size)
+            {
+#if defined (__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+                if (SCB->CCR & SCB_CCR_DC_Msk)
+                {
+                    SCB_InvalidateDCache_by_Addr((uint32_t*)addr, size);
+                }
+#endif
+            }
+        };
+        SDRAM_DMA* SDRAM_DMA_Device_HW::_owner = nullptr;
+        void* SDRAM_DMA_Device_HW::_dst = nullptr;
+        size_t SDRAM_DMA_Device_HW::_size = 0;
+        volatile bool SDRAM_DMA_Device_HW::_cpu_done = false;
+#else
+        struct irq_lock_t
+        {
+            ~irq_lock_t(void) {}
+        };
+#endif
+
+        bool SDRAM_DMA::init(void)
+        {
+            if (_device == nullptr)
+            {
+#if defined (DMA2)
+                static SDRAM_DMA_Device_HW hw_device;
+                BSP_SDRAM_DMA_RegisterCallback(SDRAM_DMA_Device_HW::callback);
+                _device = &hw_device;
+#else
+                return false;
+#endif
+            }
+            return true;
+        }
+
+        uint32_t SDRAM_DMA::copy(void* dst, const void* src, size_t bytes,
+                                 sdram_dma_callback_t callback, void* user)
+        {
+            if (_device == nullptr || !bytes
+             || ((uintptr_t)dst | (uintptr_t)src | bytes) & 3)
+            {
+                return 0;
+            }
+            if (_count == queue_size)
+            {
+                ++_stats.queue_full;
+                while (_count == queue_size) { _poll(); }
+            }
+
+            irq_lock_t lock;
+            auto& e = _queue[(_head + _count) % queue_size];
+            e.src       = (const uint8_t*)src;
+            e.dst       = (uint8_t*)dst;
+            e.words     = bytes >> 2;
+            e.done      = 0;
+            e.id        = _next_id++;
+            e.queued_us = _now();
+            e.callback  = callback;
+            e.user      = user;
+            if (!_next_id) { _next_id = 1; }
+            uint32_t id = e.id;
+            ++_count;
+            if (!_active)
+            {
+                _active = true;
+                _start(e);
+            }
+            return id;
+        }
+
+        void SDRAM_DMA::_start(entry_t& e)
+        {
+            /// DMA の1回の転送量を超える要求は分割して続けて転送する
+            uint32_t max_words = _device->maxWords();
+            _chunk = e.words - e.done < max_words ? e.words - e.done : max_words;
+            if (!e.done) { e.started_us = _now(); }
+            if (!_device->start(this, e.src + (e.done << 2), e.dst + (e.done << 2), _chunk))
+            {
+                complete(true);
+            }
+        }
+
+        void SDRAM_DMA::complete(bool error)
+        {
+            if (!_count) return;
+            auto& e = _queue[_head];
+            if (!error)
+            {
+                e.done += _chunk;
+                if (e.done < e.words)
+                {
+                    _start(e);
+                    return;
+                }
+            }
+
+            uint32_t now = _now();
+            sdram_dma_result_t result;
+            result.id          = e.id;
+            result.bytes       = e.done << 2;
+            result.latency_us  = now - e.queued_us;
+            result.transfer_us = now - e.started_us;
+            result.error       = error;
+            auto callback = e.callback;
+            auto user = e.user;
+
+            ++_stats.transfers;
+            _stats.bytes += result.bytes;
+            _stats.transfer_us += result.transfer_us;
+            if (error) { ++_stats.errors; }
+            if (_stats.max_latency_us < result.latency_us) { _stats.max_latency_us = result.latency_us; }
+
+            _head = (_head + 1) % queue_size;
+            --_count;
+            _done_id = result.id;
+            /// 次の転送を先に開始してから通知する
+            if (_count)
+            {
+                _start(_queue[_head]);
+            }
+            else
+            {
+                _active = false;
+            }
+            if (callback)
+            {
+                callback(result, user);
+            }
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        class SDRAM_DMA;
+
+        struct sdram_dma_result_t
+        {
+            uint32_t id;
+            uint32_t bytes;
+            uint32_t latency_us;   // copy() を呼んでから完了まで
+            uint32_t transfer_us;  // 転送を開始してから完了まで
+            bool error;
+        };
+
+        /// 完了時に割り込みから呼ばれる。この中で copy() を呼ばないこと
+        typedef void (*sdram_dma_callback_t)(const sdram_dma_result_t& result, void* user);
+
+        struct sdram_dma_stats_t
+        {
+            uint32_t transfers;
+            uint32_t bytes;
+            uint32_t errors;
+            uint32_t queue_full;       // キューの空きを待った回数
+            uint32_t max_latency_us;
+            uint64_t transfer_us;      // 転送にかかった時間の合計。bytes / transfer_us で転送速度になる
+        };
+
+        struct ISDRAM_DMA_Device
+        {
+            virtual ~ISDRAM_DMA_Device(void) = default;
+            /// words 個の32bitの転送を開始する。完了したら owner->complete() を呼ぶ (割り込みから呼んでよい)
+            virtual bool start(SDRAM_DMA* owner, const void* src, void* dst, uint32_t words) = 0;
+            /// 割り込みを使わない実装は、ここで完了を調べて complete() を呼ぶ
+            virtual void poll(void) {}
+            /// 1回に転送できる最大のワード数 (DMA の NDTR は16bit)
+            virtual uint32_t maxWords(void) const { return 0xFFFF; }
+        };
+
+        /// SDRAM との間の DMA 転送を積んでおき、前の転送の完了割り込みで次を開始する。
+        /// 素材の読み込みや書き出しを CPU の描画と並行して行うために使う
+        class SDRAM_DMA
+        {
+        public:
+            /// 完了を待っている要求を保持しておける数
+            static constexpr size_t queue_size = 16;
+
+            /// 未指定の場合、init() で DMA2_Stream0 (BSP_SDRAM_DMA_Start) を使う
+            void setDevice(ISDRAM_DMA_Device* device) { _device = device; }
+            ISDRAM_DMA_Device* getDevice(void) const { return _device; }
+            /// 所要時間の計測に使う。未指定の場合は時間を 0 とする
+            void setClock(uint32_t (*micros)(void)) { _micros = micros; }
+
+            bool init(void);
+
+            /// bytes の転送を積んで、完了を待たずに要求の番号を返す。失敗時は 0。
+            /// src・dst・bytes は4の倍数であること。キューが満杯なら空くまで待つ。
+            /// 完了するまで src を変更したり dst を読んだりしないこと。
+            /// D-cache が有効な場合、dst と bytes が32バイト境界に揃っていなければ CPU で写し、完了は wait() などで通知する
+            uint32_t copy(void* dst, const void* src, size_t bytes,
+                          sdram_dma_callback_t callback = nullptr, void* user = nullptr);
+
+            /// 番号 id の要求が完了していれば true (失敗を含む)
+            bool isDone(uint32_t id) const { return (int32_t)(_done_id - id) >= 0; }
+            void wait(uint32_t id) { while (!isDone(id)) { _poll(); } }
+            void wait(void) { while (busy()); }
+            bool busy(void) { _poll(); return _active; }
+            size_t getPending(void) const { return _count; }
+
+            const sdram_dma_stats_t& getStats(void) const { return _stats; }
+            void resetStats(void) { _stats = sdram_dma_stats_t(); }
+
+            /// デバイスの転送完了時に呼ぶ
+            void complete(bool error);
+
+        private:
+            struct entry_t
+            {
+                const uint8_t* src;
+                uint8_t* dst;
+                uint32_t words;
+                uint32_t done;
+                uint32_t id;
+                uint32_t queued_us;
+                uint32_t started_us;
+                sdram_dma_callback_t callback;
+                void* user;
+            };
+
+            ISDRAM_DMA_Device* _device = nullptr;
+            uint32_t (*_micros)(void) = nullptr;
+            sdram_dma_stats_t _stats = {};
+
+            /// 完了割り込みが _head 側から取り出し、copy() が末尾に積むリングバッファ
+            entry_t _queue[queue_size];
+            volatile uint8_t _head = 0;
+            volatile uint8_t _count = 0;
+            volatile bool _active = false;
+            uint32_t _chunk = 0;
+            uint32_t _next_id = 1;
+            volatile uint32_t _done_id = 0;
+
+            uint32_t _now(void) const { return _micros ? _micros() : 0; }
+            void _poll(void) { if (_device) { _device->poll(); } }
+            void _start(entry_t& e);
+        };
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <LovyanGFX.hpp>
+#include "SDRAM_Arena.hpp"
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        /// arena から確保した領域をスプライトのバッファにする。失敗時は false。
+        /// 解放は deleteSpriteInArena() で行う (LGFX_Sprite は外部のバッファを解放しない)
+        inline bool createSpriteInArena(LGFX_Sprite& sprite, SDRAM_Arena& arena,
+                                        int32_t w, int32_t h,
+                                        color_depth_t depth = color_depth_t::rgb565_2Byte)
+        {
+            size_t bytes = (((size_t)w * (depth & color_depth_t::bit_mask) + 7) >> 3) * h;
+            void* buf = arena.alloc(bytes);
+            if (buf == nullptr)
+            {
+                return false;
+            }
+            sprite.setBuffer(buf, w, h, depth);
+            return true;
+        }
+
+        inline void deleteSpriteInArena(LGFX_Sprite& sprite, SDRAM_Arena& arena)
+        {
+            void* buf = sprite.getBuffer();
+            sprite.deleteSprite();
+            arena.free(buf);
+        }
+
+        /// pool のブロックをスプライトのバッファにする。ブロックが小さい場合は false
+        inline bool createSpriteInPool(LGFX_Sprite& sprite, SDRAM_Pool& pool,
+                                       int32_t w, int32_t h,
+                                       color_depth_t depth = color_depth_t::rgb565_2Byte)
+        {
+            size_t bytes = (((size_t)w * (depth & color_depth_t::bit_mask) + 7) >> 3) * h;
+            if (bytes > pool.getBlockSize())
+            {
+                return false;
+            }
+            void* buf = pool.alloc();
+            if (buf == nullptr)
+            {
+                return false;
+            }
+            sprite.setBuffer(buf, w, h, depth);
+            return true;
+        }
+
+        inline void deleteSpriteInPool(LGFX_Sprite& sprite, SDRAM_Pool& pool)
+        {
+            void* buf = sprite.getBuffer();
+            sprite.deleteSprite();
+            pool.free(buf);
+        }
+    }
+}
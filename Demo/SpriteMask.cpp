@@ -0,0 +1,97 @@
+#include "SpriteMask.hpp"
+#include "pixel_kernels.hpp"
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        /// 1行の区間を out に書き出し (out が nullptr の場合は数えるだけ)、区間の数を返す
+        template <typename T>
+        static size_t scan_row(const T* s, size_t w, uint32_t key, uint16_t* out)
+        {
+            size_t n = 0;
+            size_t i = 0;
+            while (w != (i = kernels::skip_key(s, i, w, key)))
+            {
+                size_t e = kernels::find_key(s, i, w, key);
+                if (out)
+                {
+                    out[n * 2]     = i;
+                    out[n * 2 + 1] = e - i;
+                }
+                ++n;
+                i = e;
+            }
+            return n;
+        }
+
+        static size_t scan_row_bytes(const void* s, size_t w, uint32_t key, uint_fast8_t bytes, uint16_t* out)
+        {
+            switch (bytes)
+            {
+            case 1:  return scan_row((const uint8_t        *)s, w, key & 0xFF    , out);
+            case 2:  return scan_row((const uint16_t       *)s, w, key & 0xFFFF  , out);
+            case 3:  return scan_row((const kernels::px24_t*)s, w, key & 0xFFFFFF, out);
+            default: return scan_row((const uint32_t       *)s, w, key           , out);
+            }
+        }
+
+        bool SpriteMask::build(SDRAM_Arena& arena, const void* pixels,
+                               uint_fast16_t w, uint_fast16_t h, uint_fast8_t bytes,
+                               uint32_t transp, uint32_t pitch)
+        {
+            release();
+            if (!pixels || !w || !h || bytes < 1 || bytes > 4)
+            {
+                return false;
+            }
+            if (!pitch) { pitch = w; }
+
+            /// 1回目で区間の数を数え、表の大きさを決める
+            auto src = (const uint8_t*)pixels;
+            size_t line = (size_t)pitch * bytes;
+            size_t runs = 0;
+            for (uint_fast16_t y = 0; y < h; ++y)
+            {
+                runs += scan_row_bytes(src + y * line, w, transp, bytes, nullptr);
+            }
+            size_t rows_bytes = sizeof(uint32_t) * h;
+            auto buf = (uint8_t*)arena.alloc(rows_bytes + sizeof(uint16_t) * (h + runs * 2), 4);
+            if (buf == nullptr)
+            {
+                return false;
+            }
+            _arena = &arena;
+            _rows = (uint32_t*)buf;
+            _data = (uint16_t*)(buf + rows_bytes);
+
+            uint32_t pos = 0;
+            for (uint_fast16_t y = 0; y < h; ++y)
+            {
+                _rows[y] = pos;
+                size_t n = scan_row_bytes(src + y * line, w, transp, bytes, &_data[pos + 1]);
+                _data[pos] = n;
+                pos += 1 + n * 2;
+            }
+            _runs = runs;
+            _pitch = pitch;
+            _w = w;
+            _h = h;
+            _bytes = bytes;
+            return true;
+        }
+
+        void SpriteMask::release(void)
+        {
+            if (_arena)
+            {
+                _arena->free(_rows);
+                _arena = nullptr;
+            }
+            _rows = nullptr;
+            _data = nullptr;
+            _runs = 0;
+            _w = _h = 0;
+        }
+    }
+}
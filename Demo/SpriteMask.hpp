@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "SDRAM_Arena.hpp"
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        /// 透過色を持つ画像 (スプライト) の、透過しない画素の連続を行ごとに求めて保持する。
+        /// LGFX_LTDC_Device::pushImageMasked() で使うと、透過する部分は比較せずに飛ばし、区間ごとに直接書く。
+        /// 画像の画素を変更した場合は build() し直すこと。使い終わったら release() で表を解放する
+        class SpriteMask
+        {
+        public:
+            /// pixels は表示と同じ画素形式 (bytes バイト/画素) の w x h 画素、pitch は1行の画素数 (0 の場合は w)。
+            /// transp は透過色の生の値 (rgb565_2Byte ではバイト順を入れ替えた値)。
+            /// 区間の表は arena から確保する。失敗時は false
+            bool build(SDRAM_Arena& arena, const void* pixels,
+                       uint_fast16_t w, uint_fast16_t h, uint_fast8_t bytes,
+                       uint32_t transp, uint32_t pitch = 0);
+            void release(void);
+
+            bool isValid(void) const { return _rows != nullptr; }
+            uint_fast16_t width(void) const { return _w; }
+            uint_fast16_t height(void) const { return _h; }
+            uint_fast8_t bytes(void) const { return _bytes; }
+            uint32_t pitch(void) const { return _pitch; }
+            /// 全ての行の区間の数の合計
+            size_t getRunCount(void) const { return _runs; }
+
+            /// y 行目の区間。先頭が区間の数で、続いて開始位置と長さの組が左から並ぶ
+            const uint16_t* row(uint_fast16_t y) const { return _data + _rows[y]; }
+
+        private:
+            SDRAM_Arena* _arena = nullptr;
+            uint32_t* _rows = nullptr;   // 各行の区間の _data 内の位置
+            uint16_t* _data = nullptr;
+            size_t _runs = 0;
+            uint32_t _pitch = 0;
+            uint16_t _w = 0;
+            uint16_t _h = 0;
+            uint8_t _bytes = 0;
+        };
+    }
+}
@@ -0,0 +1,55 @@
+#include "host_dma2d.hpp"
+
+namespace host
+{
+    DMA2D_Device_Thread::DMA2D_Device_Thread(void)
+    : _thread(&DMA2D_Device_Thread::_loop, this)
+    {
+    }
+
+    DMA2D_Device_Thread::~DMA2D_Device_Thread(void)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _quit = true;
+        }
+        _cond.notify_one();
+        _thread.join();
+    }
+
+    void DMA2D_Device_Thread::start(lgfx::DMA2D_Engine* owner, const lgfx::dma2d_desc_t& desc)
+    {
+        /// 実機のレジスタと同じく、前の転送中に書き換えることはない
+        while (busy()) {}
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _owner = owner;
+            _desc = desc;
+            _busy.store(true, std::memory_order_release);
+        }
+        _cond.notify_one();
+    }
+
+    void DMA2D_Device_Thread::poll(void)
+    {
+        if (_owner == nullptr || busy()) return;
+        auto owner = _owner;
+        _owner = nullptr;
+        owner->complete();
+    }
+
+    void DMA2D_Device_Thread::_loop(void)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;)
+        {
+            _cond.wait(lock, [this] { return _quit || _busy.load(std::memory_order_relaxed); });
+            if (_quit) return;
+            auto desc = _desc;
+            lock.unlock();
+            _soft.start(nullptr, desc);
+            lock.lock();
+            _busy.store(false, std::memory_order_release);
+        }
+    }
+}
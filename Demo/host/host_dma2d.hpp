@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../DMA2D_Engine.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace host
+{
+    /// 要求を別スレッドで DMA2D_Device_Soft に処理させ、実機と同じく start() がすぐ戻るようにする。
+    /// 転送元を早く書き換える、完了を待たずに CPU で描くといった誤りをホスト上で見つけるために使う。
+    /// 完了の通知 (実機の完了割り込みに相当) は、競合を避けるため poll() の中で描画側のスレッドから行う
+    class DMA2D_Device_Thread : public lgfx::IDMA2D_Device
+    {
+    public:
+        DMA2D_Device_Thread(void);
+        ~DMA2D_Device_Thread(void) override;
+
+        void start(lgfx::DMA2D_Engine* owner, const lgfx::dma2d_desc_t& desc) override;
+        void poll(void) override;
+        bool busy(void) const { return _busy.load(std::memory_order_acquire); }
+
+    private:
+        lgfx::DMA2D_Device_Soft _soft;
+        lgfx::DMA2D_Engine* _owner = nullptr;
+        lgfx::dma2d_desc_t _desc = {};
+        std::atomic<bool> _busy { false };
+        bool _quit = false;
+        std::mutex _mutex;
+        std::condition_variable _cond;
+        std::thread _thread;
+
+        void _loop(void);
+    };
+}
@@ -0,0 +1,328 @@
+#include "host_ltdc.hpp"
+#include "stm32f7xx_hal_rcc.h"
+#include <stdio.h>
+#include <string.h>
+
+LTDC_TypeDef host_ltdc_regs;
+
+namespace host
+{
+    /// シャドウレジスタに相当するレイヤーの状態
+    struct layer_state_t
+    {
+        LTDC_LayerCfgTypeDef cfg;
+        uint32_t clut[256];
+        uint32_t color_key;
+        uint32_t pitch;   // CFBLR の CFBP (bytes)
+        bool enable;
+        bool clut_enable;
+        bool key_enable;
+    };
+
+    static LTDC_HandleTypeDef* _handle = nullptr;
+    static layer_state_t _pending[MAX_LAYER];
+    static layer_state_t _active[MAX_LAYER];
+
+    static void reload(void)
+    {
+        memcpy(_active, _pending, sizeof(_active));
+        host_ltdc_regs.SRCR = 0;
+    }
+
+    static bool valid(LTDC_HandleTypeDef* hltdc, uint32_t idx)
+    {
+        return hltdc && idx < MAX_LAYER;
+    }
+
+    static uint32_t expand(uint32_t v, uint_fast8_t bits)
+    {
+        /// 下位ビットは上位ビットの複製で埋める
+        v <<= 8 - bits;
+        return v | v >> bits;
+    }
+
+    /// 1画素を読み、0xAARRGGBB にする
+    static uint32_t fetch(const layer_state_t& l, const uint8_t* p)
+    {
+        uint32_t a = 0xFF, r, g, b, v;
+        switch (l.cfg.PixelFormat)
+        {
+        case LTDC_PIXEL_FORMAT_ARGB8888:
+            return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+
+        case LTDC_PIXEL_FORMAT_RGB888:
+            return p[0] | p[1] << 8 | p[2] << 16 | 0xFF000000u;
+
+        case LTDC_PIXEL_FORMAT_RGB565:
+            v = p[0] | p[1] << 8;
+            r = expand(v >> 11, 5); g = expand((v >> 5) & 0x3F, 6); b = expand(v & 0x1F, 5);
+            break;
+
+        case LTDC_PIXEL_FORMAT_ARGB1555:
+            v = p[0] | p[1] << 8;
+            a = (v & 0x8000) ? 0xFF : 0;
+            r = expand((v >> 10) & 0x1F, 5); g = expand((v >> 5) & 0x1F, 5); b = expand(v & 0x1F, 5);
+            break;
+
+        case LTDC_PIXEL_FORMAT_ARGB4444:
+            v = p[0] | p[1] << 8;
+            a = ((v >> 12) & 0xF) * 0x11;
+            r = ((v >> 8) & 0xF) * 0x11; g = ((v >> 4) & 0xF) * 0x11; b = (v & 0xF) * 0x11;
+            break;
+
+        case LTDC_PIXEL_FORMAT_L8:
+            v = l.clut_enable ? l.clut[p[0]] : p[0] * 0x010101u;
+            return 0xFF000000u | v;
+
+        case LTDC_PIXEL_FORMAT_AL44:
+            a = (p[0] >> 4) * 0x11;
+            v = l.clut_enable ? l.clut[p[0] & 0xF] : (p[0] & 0xF) * 0x111111u;
+            return a << 24 | v;
+
+        default: // LTDC_PIXEL_FORMAT_AL88
+            a = p[1];
+            v = l.clut_enable ? l.clut[p[0]] : p[0] * 0x010101u;
+            return a << 24 | v;
+        }
+        return a << 24 | r << 16 | g << 8 | b;
+    }
+
+    static uint_fast8_t format_bytes(uint32_t format)
+    {
+        switch (format)
+        {
+        case LTDC_PIXEL_FORMAT_ARGB8888: return 4;
+        case LTDC_PIXEL_FORMAT_RGB888:   return 3;
+        case LTDC_PIXEL_FORMAT_L8:
+        case LTDC_PIXEL_FORMAT_AL44:     return 1;
+        default:                         return 2;
+        }
+    }
+
+    /// HAL の LTDC_SetConfig と同じく、レイヤーの設定を書き込みピッチを ImageWidth から計算し直す
+    static void set_config(LTDC_HandleTypeDef* hltdc, uint32_t idx)
+    {
+        auto& c = hltdc->LayerCfg[idx];
+        _pending[idx].cfg = c;
+        _pending[idx].pitch = c.ImageWidth * format_bytes(c.PixelFormat);
+    }
+
+    bool ltdc_compose(std::vector<uint32_t>& dst, uint_fast16_t& width, uint_fast16_t& height)
+    {
+        if (_handle == nullptr)
+        {
+            return false;
+        }
+        auto& init = _handle->Init;
+        width  = init.AccumulatedActiveW - init.AccumulatedHBP;
+        height = init.AccumulatedActiveH - init.AccumulatedVBP;
+        uint32_t back = init.Backcolor.Red << 16 | init.Backcolor.Green << 8 | init.Backcolor.Blue;
+        dst.assign(width * height, back);
+
+        for (auto& l : _active)
+        {
+            if (!l.enable || !l.cfg.FBStartAdress) continue;
+            auto& c = l.cfg;
+            uint_fast8_t bytes = format_bytes(c.PixelFormat);
+            size_t pitch = l.pitch;
+            for (uint32_t y = c.WindowY0; y < c.WindowY1 && y < height; ++y)
+            {
+                auto src = (const uint8_t*)c.FBStartAdress + (y - c.WindowY0) * pitch;
+                auto d = &dst[y * width];
+                for (uint32_t x = c.WindowX0; x < c.WindowX1 && x < width; ++x)
+                {
+                    uint32_t argb = fetch(l, &src[(x - c.WindowX0) * bytes]);
+                    if (l.key_enable && (argb & 0xFFFFFF) == (l.color_key & 0xFFFFFF))
+                    {
+                        continue;
+                    }
+                    /// 定数アルファのみの場合は画素のアルファを使わない
+                    uint32_t a = (c.BlendingFactor1 == LTDC_BLENDING_FACTOR1_PAxCA)
+                               ? (argb >> 24) * c.Alpha / 255
+                               : c.Alpha;
+                    uint32_t below = d[x];
+                    uint32_t result = 0;
+                    for (int s = 0; s < 24; s += 8)
+                    {
+                        uint32_t fg = (argb  >> s) & 0xFF;
+                        uint32_t bg = (below >> s) & 0xFF;
+                        result |= ((fg * a + bg * (255 - a)) / 255) << s;
+                    }
+                    d[x] = result;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool write_ppm(const char* path, const uint32_t* rgb888, uint_fast16_t width, uint_fast16_t height)
+    {
+        FILE* fp = fopen(path, "wb");
+        if (fp == nullptr)
+        {
+            return false;
+        }
+        fprintf(fp, "P6\n%u %u\n255\n", (unsigned)width, (unsigned)height);
+        std::vector<uint8_t> line(width * 3);
+        for (uint_fast16_t y = 0; y < height; ++y)
+        {
+            for (uint_fast16_t x = 0; x < width; ++x)
+            {
+                uint32_t c = rgb888[y * width + x];
+                line[x * 3 + 0] = c >> 16;
+                line[x * 3 + 1] = c >> 8;
+                line[x * 3 + 2] = c;
+            }
+            fwrite(line.data(), 1, line.size(), fp);
+        }
+        return fclose(fp) == 0;
+    }
+
+    bool ltdc_write_ppm(const char* path)
+    {
+        std::vector<uint32_t> img;
+        uint_fast16_t w, h;
+        return ltdc_compose(img, w, h) && write_ppm(path, img.data(), w, h);
+    }
+}
+
+using namespace host;
+
+extern "C"
+{
+    HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef*)
+    {
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_LTDC_Init(LTDC_HandleTypeDef* hltdc)
+    {
+        if (hltdc == nullptr) return HAL_ERROR;
+        _handle = hltdc;
+        memset(_pending, 0, sizeof(_pending));
+        reload();
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_LTDC_ConfigLayer(LTDC_HandleTypeDef* hltdc, LTDC_LayerCfgTypeDef* pLayerCfg, uint32_t LayerIdx)
+    {
+        if (!valid(hltdc, LayerIdx) || pLayerCfg == nullptr) return HAL_ERROR;
+        hltdc->LayerCfg[LayerIdx] = *pLayerCfg;
+        set_config(hltdc, LayerIdx);
+        _pending[LayerIdx].enable = true;
+        reload();
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_LTDC_SetPixelFormat(LTDC_HandleTypeDef* hltdc, uint32_t Pixelformat, uint32_t LayerIdx)
+    {
+        if (!valid(hltdc, LayerIdx)) return HAL_ERROR;
+        hltdc->LayerCfg[LayerIdx].PixelFormat = Pixelformat;
+        set_config(hltdc, LayerIdx);
+        reload();
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_LTDC_ConfigCLUT(LTDC_HandleTypeDef* hltdc, uint32_t* pCLUT, uint32_t CLUTSize, uint32_t LayerIdx)
+    {
+        if (!valid(hltdc, LayerIdx) || CLUTSize > 256) return HAL_ERROR;
+        memcpy(_pending[LayerIdx].clut, pCLUT, CLUTSize * sizeof(uint32_t));
+        reload();
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_LTDC_EnableCLUT(LTDC_HandleTypeDef* hltdc, uint32_t LayerIdx)
+    {
+        if (!valid(hltdc, LayerIdx)) return HAL_ERROR;
+        _pending[LayerIdx].clut_enable = true;
+        reload();
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_LTDC_DisableCLUT(LTDC_HandleTypeDef* hltdc, uint32_t LayerIdx)
+    {
+        if (!valid(hltdc, LayerIdx)) return HAL_ERROR;
+        _pending[LayerIdx].clut_enable = false;
+        reload();
+        return HAL_OK;
+    }
+
+    /// ホストではVブランクを待たずに反映する (VBR は立てない)
+    HAL_StatusTypeDef HAL_LTDC_Reload(LTDC_HandleTypeDef* hltdc, uint32_t)
+    {
+        if (hltdc == nullptr) return HAL_ERROR;
+        reload();
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_LTDC_SetAddress_NoReload(LTDC_HandleTypeDef* hltdc, uintptr_t Address, uint32_t LayerIdx)
+    {
+        if (!valid(hltdc, LayerIdx)) return HAL_ERROR;
+        hltdc->LayerCfg[LayerIdx].FBStartAdress = Address;
+        set_config(hltdc, LayerIdx);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_LTDC_SetPitch_NoReload(LTDC_HandleTypeDef* hltdc, uint32_t LinePitchInPixels, uint32_t LayerIdx)
+    {
+        if (!valid(hltdc, LayerIdx)) return HAL_ERROR;
+        _pending[LayerIdx].pitch = LinePitchInPixels * format_bytes(_pending[LayerIdx].cfg.PixelFormat);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_LTDC_SetPitch(LTDC_HandleTypeDef* hltdc, uint32_t LinePitchInPixels, uint32_t LayerIdx)
+    {
+        if (HAL_LTDC_SetPitch_NoReload(hltdc, LinePitchInPixels, LayerIdx) != HAL_OK) return HAL_ERROR;
+        reload();
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_LTDC_SetWindowPosition_NoReload(LTDC_HandleTypeDef* hltdc, uint32_t X0, uint32_t Y0, uint32_t LayerIdx)
+    {
+        if (!valid(hltdc, LayerIdx)) return HAL_ERROR;
+        auto& c = hltdc->LayerCfg[LayerIdx];
+        c.WindowX0 = X0;
+        c.WindowX1 = X0 + c.ImageWidth;
+        c.WindowY0 = Y0;
+        c.WindowY1 = Y0 + c.ImageHeight;
+        set_config(hltdc, LayerIdx);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_LTDC_SetAlpha_NoReload(LTDC_HandleTypeDef* hltdc, uint32_t Alpha, uint32_t LayerIdx)
+    {
+        if (!valid(hltdc, LayerIdx)) return HAL_ERROR;
+        hltdc->LayerCfg[LayerIdx].Alpha = Alpha;
+        set_config(hltdc, LayerIdx);
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_LTDC_ConfigColorKeying_NoReload(LTDC_HandleTypeDef* hltdc, uint32_t RGBValue, uint32_t LayerIdx)
+    {
+        if (!valid(hltdc, LayerIdx)) return HAL_ERROR;
+        _pending[LayerIdx].color_key = RGBValue;
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_LTDC_EnableColorKeying_NoReload(LTDC_HandleTypeDef* hltdc, uint32_t LayerIdx)
+    {
+        if (!valid(hltdc, LayerIdx)) return HAL_ERROR;
+        _pending[LayerIdx].key_enable = true;
+        return HAL_OK;
+    }
+
+    HAL_StatusTypeDef HAL_LTDC_DisableColorKeying_NoReload(LTDC_HandleTypeDef* hltdc, uint32_t LayerIdx)
+    {
+        if (!valid(hltdc, LayerIdx)) return HAL_ERROR;
+        _pending[LayerIdx].key_enable = false;
+        return HAL_OK;
+    }
+
+    void host_ltdc_layer_enable(LTDC_HandleTypeDef* hltdc, uint32_t LayerIdx, int enable)
+    {
+        if (valid(hltdc, LayerIdx))
+        {
+            _pending[LayerIdx].enable = enable;
+        }
+    }
+}
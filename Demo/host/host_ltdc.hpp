@@ -0,0 +1,17 @@
+#pragma once
+
+#include "stm32f7xx_hal_ltdc.h"
+#include <vector>
+
+namespace host
+{
+    /// 最後にリロードされたレイヤー設定から、画面に表示される画像を 0x00RRGGBB で合成する。
+    /// HAL_LTDC_Init() 前は false を返す
+    bool ltdc_compose(std::vector<uint32_t>& dst, uint_fast16_t& width, uint_fast16_t& height);
+
+    /// ltdc_compose() の結果を PPM (P6) で書き出す
+    bool ltdc_write_ppm(const char* path);
+
+    /// 0x00RRGGBB の画像を PPM (P6) で書き出す
+    bool write_ppm(const char* path, const uint32_t* rgb888, uint_fast16_t width, uint_fast16_t height);
+}
@@ -0,0 +1,34 @@
+#include "host_sdram_dma.hpp"
+#include <string.h>
+
+namespace host
+{
+    bool SDRAM_DMA_Device_Sim::start(lgfx::SDRAM_DMA* owner, const void* src, void* dst, uint32_t words)
+    {
+        /// 実機と同じく、転送中や1回の上限を超える要求は受け付けない
+        if (_remain || !words || words > _max_words)
+        {
+            return false;
+        }
+        _owner = owner;
+        _src = src;
+        _dst = dst;
+        _words = words;
+        _remain = _latency;
+        ++_starts;
+        return true;
+    }
+
+    void SDRAM_DMA_Device_Sim::poll(void)
+    {
+        if (!_remain || --_remain) return;
+
+        bool error = _fail;
+        _fail = false;
+        if (!error)
+        {
+            memcpy(_dst, _src, _words << 2);
+        }
+        _owner->complete(error);
+    }
+}
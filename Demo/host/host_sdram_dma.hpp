@@ -0,0 +1,34 @@
+#pragma once
+
+#include "../SDRAM_DMA.hpp"
+
+namespace host
+{
+    /// DMA2_Stream0 の代わり。start() では転送せず、poll() が指定回数呼ばれたところで
+    /// 転送して SDRAM_DMA::complete() を呼ぶ (実機の完了割り込みに相当)
+    class SDRAM_DMA_Device_Sim : public lgfx::ISDRAM_DMA_Device
+    {
+    public:
+        bool start(lgfx::SDRAM_DMA* owner, const void* src, void* dst, uint32_t words) override;
+        void poll(void) override;
+        uint32_t maxWords(void) const override { return _max_words; }
+
+        /// 転送が完了するまでの poll() の回数
+        void setLatency(uint32_t polls) { _latency = polls ? polls : 1; }
+        void setMaxWords(uint32_t words) { _max_words = words; }
+        /// 次の転送を失敗させる
+        void failNext(void) { _fail = true; }
+        uint32_t getStartCount(void) const { return _starts; }
+
+    private:
+        lgfx::SDRAM_DMA* _owner = nullptr;
+        const void* _src = nullptr;
+        void* _dst = nullptr;
+        uint32_t _words = 0;
+        uint32_t _latency = 1;
+        uint32_t _remain = 0;
+        uint32_t _max_words = 0xFFFF;
+        uint32_t _starts = 0;
+        bool _fail = false;
+    };
+}
@@ -0,0 +1,534 @@
+/// Panel_LTDC をPC上で動かし、回転・色深度ごとの表示結果を PPM で書き出す。
+/// 使い方: ltdc_host [出力先ディレクトリ]
+///         ltdc_host --check [出力先ディレクトリ]  (表示結果を比べ、食い違いがあれば 1 を返す)
+///         ltdc_host --bench [csv|json|text]  (Benchmark.hpp の計測のみ行う)
+#define LGFX_USE_V1
+#include <LovyanGFX.hpp>
+#include "../Panel_LTDC.hpp"
+#include "../Panel_LTDC_T.hpp"
+#include "../LGFX_LTDC_Device.hpp"
+#include "../Benchmark.hpp"
+#include "host_ltdc.hpp"
+#include "host_dma2d.hpp"
+#include "host_sdram_dma.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+class LGFX_LTDC_Host: public lgfx::LGFX_LTDC_Device
+{
+    lgfx::Panel_LTDC _panel_instance;
+
+    public:
+    LGFX_LTDC_Host(uint8_t* framebuffer)
+    {
+        // SDRAM_DEVICE_ADDR の代わりに通常のメモリを使う
+        _panel_instance.setFrameBuffer(framebuffer);
+
+        lgfx::Panel_LTDC::panel_timing_t panel_cfg = {
+            .h = {
+                .sync        =  41,
+                .back_porch  =  13,
+                .active      = 480,
+                .front_porch =  32,
+            },
+            .v = {
+                .sync        =  10,
+                .back_porch  =  10,
+                .active      = 272,
+                .front_porch =   2,
+            },
+        };
+        _panel_instance.setPanelTiming(panel_cfg);
+
+        auto cfg = _panel_instance.config();
+        cfg.memory_width  = panel_cfg.h.active;
+        cfg.memory_height = panel_cfg.v.active;
+        _panel_instance.config(cfg);
+
+        setPanel(&_panel_instance);
+    }
+
+    lgfx::Panel_LTDC& getPanelLTDC(void) { return _panel_instance; }
+};
+
+/// 比較用に、大きさと色深度を固定した Panel_LTDC_T をレイヤー1に置いたもの (表示はしない)
+class LGFX_LTDC_Host_Fixed: public lgfx::LGFX_LTDC_Device
+{
+    lgfx::Panel_LTDC_T<480, 272> _panel_instance;
+
+    public:
+    LGFX_LTDC_Host_Fixed(uint8_t* framebuffer, lgfx::Panel_LTDC& base)
+    {
+        _panel_instance.setFrameBuffer(framebuffer);
+        _panel_instance.setBaseLayer(&base, 1);
+        _panel_instance.setLayerVisible(false);
+        setPanel(&_panel_instance);
+    }
+
+    lgfx::Panel_LTDC& getPanelLTDC(void) { return _panel_instance; }
+};
+
+/// SDRAM の代わりの 8MiB の領域
+static uint8_t sdram[8 * 1024 * 1024];
+static lgfx::SDRAM_Arena arena;
+static uint16_t image[64 * 48];
+/// SDRAM へ DMA で転送した image
+static uint16_t* image_sdram;
+static host::SDRAM_DMA_Device_Sim sdram_dma_device;
+static lgfx::SDRAM_DMA sdram_dma;
+
+/// 回転の向きが分かるよう、原点側に印を付けた図形を描く
+static void draw_pattern(lgfx::LGFX_LTDC_Device& gfx)
+{
+    gfx.fillScreen(TFT_NAVY);
+    gfx.fillRect(0, 0, 24, 24, TFT_RED);
+    gfx.fillTriangle(gfx.width() - 1, 0, gfx.width() - 25, 0, gfx.width() - 1, 24, TFT_GREEN);
+    gfx.drawRect(0, 0, gfx.width(), gfx.height(), TFT_WHITE);
+    for (int i = 0; i < 8; ++i)
+    {
+        gfx.drawLine(32, 32 + i * 8, gfx.width() - 33, gfx.height() - 33 - i * 8, TFT_YELLOW);
+    }
+    gfx.fillCircle(gfx.width() / 2, gfx.height() / 2, 30, TFT_ORANGE);
+    gfx.setTextColor(TFT_WHITE);
+    gfx.setTextSize(2);
+    gfx.drawString("LTDC", 30, 4);
+
+    /// writeImage (DMA2D のキューに積み、完了を待ってから読み出す)
+    gfx.pushImageDMA(40, 40, 64, 48, (lgfx::swap565_t*)image_sdram);
+    gfx.waitDMA();
+    /// readRect で読み出して別の場所へ書き戻す
+    static uint16_t buf[64 * 48];
+    gfx.readRect(40, 40, 64, 48, buf);
+    gfx.pushImage(40, 100, 64, 48, (lgfx::swap565_t*)buf);
+
+    /// 拡大・縮小 (RGB565 では列の表、他の形式では fp_copy で書くので、結果を比べられる) と回転を伴う拡大
+    gfx.pushImageRotateZoom(180, 80, 32, 24, 0, 1.5f, 2.0f, 64, 48, (lgfx::swap565_t*)image_sdram);
+    gfx.pushImageRotateZoom(300, 60, 32, 24, 0, 0.5f, 0.75f, 64, 48, (lgfx::swap565_t*)image_sdram);
+    gfx.pushImageRotateZoom(360, 180, 32, 24, 30, 1.25f, 1.25f, 64, 48, (lgfx::swap565_t*)image_sdram);
+}
+
+/// 合成した表示結果を、回転 r の論理座標の順に並べ直して取り出す
+static bool capture(lgfx::LGFX_LTDC_Device& gfx, int r, std::vector<uint32_t>& out)
+{
+    std::vector<uint32_t> frame;
+    uint_fast16_t fw, fh;
+    gfx.waitDisplay();
+    if (!host::ltdc_compose(frame, fw, fh))
+    {
+        return false;
+    }
+    /// 奇数の回転は縦横を入れ替え、1・2・4・7 は Y、2・3・6・7 は X を反転する
+    bool swap = r & 1;
+    bool flip_x = r & 2;
+    bool flip_y = (1u << r) & 0b10010110;
+    int w = gfx.width();
+    int h = gfx.height();
+    out.resize(w * h);
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            int px = flip_x ? w - 1 - x : x;
+            int py = flip_y ? h - 1 - y : y;
+            if (swap) { std::swap(px, py); }
+            out[x + y * w] = frame[px + py * fw];
+        }
+    }
+    return true;
+}
+
+/// LGFX_LTDC_Device の塗りつぶし図形 (fillSpans() でまとめて書く) と、LGFX_Device& を通した
+/// Lovyan GFX の実装 (1行ずつ書く) で、画面からはみ出す図形を含めて全ての回転で同じ表示になることを確かめる
+static int check_fill_shapes(lgfx::LGFX_LTDC_Device& gfx, const char* dir)
+{
+    auto draw = [](auto& g)
+    {
+        int32_t w = g.width();
+        int32_t h = g.height();
+        g.fillScreen(TFT_BLACK);
+        for (int i = 0; i < 12; ++i)
+        {
+            int32_t x = (i * 97) % w;
+            int32_t y = (i * 61) % h;
+            g.fillCircle(x, y, 3 + i * 7, i & 1 ? TFT_ORANGE : TFT_CYAN);
+            g.fillTriangle(x, y, x + 90 - i * 17, y - 40 + i * 11, x - 30 + i * 9, y + 70 - i * 13, i & 1 ? TFT_GREEN : TFT_MAGENTA);
+            g.fillRoundRect(w - x - 20, h - y - 10, 40 + i * 13, 20 + i * 9, i * 3, i & 1 ? TFT_YELLOW : TFT_BLUE);
+        }
+        /// 1行・1列に潰れた図形
+        g.fillTriangle(10, h / 2, w / 2, h / 2, w - 10, h / 2, TFT_WHITE);
+        g.fillTriangle(w / 3, 5, w / 3, h / 2, w / 3, h - 5, TFT_WHITE);
+        g.fillTriangle(0, 0, w / 2, h / 4, w, h / 2, TFT_RED);
+    };
+
+    std::vector<uint32_t> spans;
+    std::vector<uint32_t> lines;
+    int failed = 0;
+    for (int r = 0; r < 8; ++r)
+    {
+        gfx.setRotation(r);
+        draw(static_cast<lgfx::LGFX_Device&>(gfx));
+        if (!capture(gfx, r, lines))
+        {
+            return 1;
+        }
+        draw(gfx);
+        if (!capture(gfx, r, spans))
+        {
+            return 1;
+        }
+        size_t diff = 0;
+        for (size_t i = 0; i < spans.size(); ++i)
+        {
+            if (spans[i] != lines[i]) { ++diff; }
+        }
+        if (diff)
+        {
+            fprintf(stderr, "fill shapes r%d: %zu pixels differ from LGFX_Device\n", r, diff);
+            ++failed;
+            if (dir)
+            {
+                char path[256];
+                snprintf(path, sizeof(path), "%s/check_fill_r%d.ppm", dir, r);
+                host::write_ppm(path, spans.data(), gfx.width(), gfx.height());
+            }
+        }
+    }
+    gfx.setRotation(0);
+    return failed;
+}
+
+/// SDRAM_DMA のキューを確かめる。キューに入りきらない数の要求と、1回の上限 (maxWords) を超えて
+/// 分割される要求を積み、転送した値・完了の順と結果・isDone()・getStats() を期待値と比べる
+static int check_sdram_dma(void)
+{
+    struct log_t
+    {
+        uint32_t count;
+        lgfx::sdram_dma_result_t results[lgfx::SDRAM_DMA::queue_size + 8];
+    };
+    static log_t log;
+    auto callback = [](const lgfx::sdram_dma_result_t& result, void* user)
+    {
+        auto l = (log_t*)user;
+        if (l->count < sizeof(l->results) / sizeof(l->results[0]))
+        {
+            l->results[l->count] = result;
+        }
+        ++l->count;
+    };
+
+    /// 先頭は分割される大きさ、続けて queue_size を超える数の小さな要求を積む
+    constexpr size_t requests = lgfx::SDRAM_DMA::queue_size + 4;
+    const size_t large = (sdram_dma_device.maxWords() + 16) << 2;
+    size_t sizes[requests];
+    size_t offsets[requests];
+    uint32_t ids[requests];
+    uint32_t* src[requests];
+    uint32_t* dst[requests];
+    size_t total = 0;
+    size_t region = 0;
+    int failed = 0;
+    for (size_t i = 0; i < requests; ++i)
+    {
+        sizes[i] = i ? 4 * (1 + i * 7) : large;
+        offsets[i] = region;
+        region += (sizes[i] + 31) & ~31u;
+        total += sizes[i];
+    }
+    /// 管理表の数に限りがあるので、転送元・転送先はそれぞれ1つの領域から切り出す
+    auto src_region = (uint8_t*)arena.alloc(region);
+    auto dst_region = (uint8_t*)arena.alloc(region);
+    if (!src_region || !dst_region)
+    {
+        fprintf(stderr, "sdram_dma: failed to allocate\n");
+        arena.free(src_region);
+        arena.free(dst_region);
+        return 1;
+    }
+    memset(dst_region, 0, region);
+    for (size_t i = 0; i < requests; ++i)
+    {
+        src[i] = (uint32_t*)&src_region[offsets[i]];
+        dst[i] = (uint32_t*)&dst_region[offsets[i]];
+        for (size_t w = 0; w < sizes[i] >> 2; ++w)
+        {
+            src[i][w] = (uint32_t)(i << 24 | w);
+        }
+    }
+
+    sdram_dma.wait();
+    sdram_dma.resetStats();
+    uint32_t starts = sdram_dma_device.getStartCount();
+    log.count = 0;
+    for (size_t i = 0; i < requests; ++i)
+    {
+        ids[i] = sdram_dma.copy(dst[i], src[i], sizes[i], callback, &log);
+    }
+    if (sdram_dma.isDone(ids[requests - 1]))
+    {
+        fprintf(stderr, "sdram_dma: last request done before waiting\n");
+        ++failed;
+    }
+    sdram_dma.wait();
+
+    for (size_t i = 0; i < requests; ++i)
+    {
+        auto& r = log.results[i];
+        if (!ids[i] || !sdram_dma.isDone(ids[i]))
+        {
+            fprintf(stderr, "sdram_dma: request %zu (id %u) not done\n", i, (unsigned)ids[i]);
+            ++failed;
+        }
+        if (i < log.count && (r.id != ids[i] || r.bytes != sizes[i] || r.error))
+        {
+            fprintf(stderr, "sdram_dma: callback %zu: id %u bytes %u error %d, expected id %u bytes %zu\n",
+                    i, (unsigned)r.id, (unsigned)r.bytes, r.error, (unsigned)ids[i], sizes[i]);
+            ++failed;
+        }
+        if (memcmp(dst[i], src[i], sizes[i]))
+        {
+            fprintf(stderr, "sdram_dma: request %zu: data differs\n", i);
+            ++failed;
+        }
+    }
+    if (log.count != requests)
+    {
+        fprintf(stderr, "sdram_dma: %u callbacks, expected %zu\n", (unsigned)log.count, requests);
+        ++failed;
+    }
+
+    /// 先頭の要求は2回に分けて転送し、queue_size を超えた分だけキューの空きを待つ
+    auto& stats = sdram_dma.getStats();
+    uint32_t chunks = sdram_dma_device.getStartCount() - starts;
+    if (stats.transfers != requests || stats.bytes != total || stats.errors
+     || stats.queue_full != requests - lgfx::SDRAM_DMA::queue_size || chunks != requests + 1)
+    {
+        fprintf(stderr, "sdram_dma: stats transfers %u bytes %u errors %u queue_full %u starts %u\n",
+                (unsigned)stats.transfers, (unsigned)stats.bytes, (unsigned)stats.errors,
+                (unsigned)stats.queue_full, (unsigned)chunks);
+        ++failed;
+    }
+
+    /// 失敗した転送は error を付けて通知し、errors に数える
+    log.count = 0;
+    sdram_dma_device.failNext();
+    uint32_t id = sdram_dma.copy(dst[1], src[1], sizes[1], callback, &log);
+    sdram_dma.wait(id);
+    if (log.count != 1 || log.results[0].id != id || !log.results[0].error || stats.errors != 1)
+    {
+        fprintf(stderr, "sdram_dma: failed transfer was not reported\n");
+        ++failed;
+    }
+
+    arena.free(dst_region);
+    arena.free(src_region);
+    return failed;
+}
+
+/// 色深度ごとに全ての回転で図形を描き、表示結果を比べる。
+/// 色の形式は RGB565 の同じ向き (偶数の回転は回転0、奇数は回転1) の結果と、粗い方の色の精度で比べる。
+/// AL44・AL88 は生の値を CLUT とアルファで表示するため、同じ形式の回転0・1の結果とだけ比べる。
+/// dir を指定した場合は食い違った結果を PPM で書き出す
+static int run_check(LGFX_LTDC_Host& gfx, const char* dir)
+{
+    struct format_t
+    {
+        const char* name;
+        lgfx::color_depth_t depth;
+        uint32_t ltdc_format;   // 0 の場合は setColorDepth() の形式
+        uint32_t mask;          // 比べる上位ビット (0 の場合は同じ形式の回転0・1と完全に一致させる)
+    };
+    static constexpr format_t formats[] =
+    {
+        { "rgb565"    , lgfx::color_depth_t::rgb565_2Byte       , 0                       , 0xF8FCF8 },
+        { "rgb565_ns" , lgfx::color_depth_t::rgb565_nonswapped  , 0                       , 0xF8FCF8 },
+        { "rgb888"    , lgfx::color_depth_t::rgb888_3Byte       , 0                       , 0xF8FCF8 },
+        { "argb8888"  , lgfx::color_depth_t::argb8888_4Byte     , 0                       , 0xF8FCF8 },
+        { "l8"        , lgfx::color_depth_t::rgb332_1Byte       , 0                       , 0xE0E0C0 },
+        { "al44"      , lgfx::color_depth_t::palette_8bit       , LTDC_PIXEL_FORMAT_AL44  , 0 },
+        { "al88"      , lgfx::color_depth_t::rgb565_nonswapped  , LTDC_PIXEL_FORMAT_AL88  , 0 },
+    };
+
+    std::vector<uint32_t> ref[2];    // RGB565 の回転0・1
+    std::vector<uint32_t> own[2];    // 同じ形式の回転0・1
+    std::vector<uint32_t> img;
+    int failed = 0;
+    for (auto& f : formats)
+    {
+        gfx.setColorDepth(f.depth);
+        if (f.ltdc_format)
+        {
+            gfx.getPanelLTDC().setPixelFormat(f.ltdc_format);
+        }
+        for (int r = 0; r < 8; ++r)
+        {
+            gfx.setRotation(r);
+            draw_pattern(gfx);
+            if (!capture(gfx, r, img))
+            {
+                fprintf(stderr, "%s r%d: failed to compose\n", f.name, r);
+                return 1;
+            }
+            if (r < 2)
+            {
+                own[r] = img;
+                if (&f == formats) { ref[r] = img; }
+            }
+
+            auto& base = f.mask ? ref[r & 1] : own[r & 1];
+            uint32_t mask = f.mask ? f.mask : 0xFFFFFF;
+            size_t diff = 0;
+            size_t first = 0;
+            for (size_t i = 0; i < img.size(); ++i)
+            {
+                if ((img[i] ^ base[i]) & mask)
+                {
+                    if (!diff++) { first = i; }
+                }
+            }
+            if (diff)
+            {
+                fprintf(stderr, "%s r%d: %zu pixels differ (first at %zu,%zu: %06x, expected %06x)\n",
+                        f.name, r, diff, first % gfx.width(), first / gfx.width(),
+                        (unsigned)img[first], (unsigned)base[first]);
+                ++failed;
+                if (dir)
+                {
+                    char path[256];
+                    snprintf(path, sizeof(path), "%s/check_%s_r%d.ppm", dir, f.name, r);
+                    host::write_ppm(path, img.data(), gfx.width(), gfx.height());
+                }
+            }
+        }
+    }
+    gfx.setColorDepth(lgfx::color_depth_t::rgb565_2Byte);
+    gfx.setRotation(0);
+    failed += check_fill_shapes(gfx, dir);
+    failed += check_sdram_dma();
+    printf("%s\n", failed ? "check failed" : "check ok");
+    return failed ? 1 : 0;
+}
+
+static void bench_out(const char* str)
+{
+    fputs(str, stdout);
+}
+
+static int run_benchmark(LGFX_LTDC_Host& gfx, const char* format)
+{
+    auto f = bench::Benchmark::format_csv;
+    if (format && !strcmp(format, "json")) { f = bench::Benchmark::format_json; }
+    if (format && !strcmp(format, "text")) { f = bench::Benchmark::format_text; }
+
+    static uint16_t buf[128 * 128];
+    bench::Benchmark b(bench_out, f, 32);
+    b.begin();
+    bench::run_standard_suite(b, gfx, buf);
+    bench::run_span_suite(b, gfx);
+    bench::run_line_suite(b, gfx);
+    bench::run_alpha_suite(b, gfx);
+    bench::run_sprite_suite(b, gfx, arena);
+    bench::run_zoom_suite(b, gfx, gfx.getPanelLTDC(), arena);
+    {
+        /// 同じ描画を Panel_LTDC と Panel_LTDC_T で比べる
+        bench::run_panel_suite(b, gfx, gfx.getPanelLTDC(), "panel");
+        auto fixed_fb = (uint8_t*)arena.alloc(480 * 272 * 2);
+        LGFX_LTDC_Host_Fixed fixed(fixed_fb, gfx.getPanelLTDC());
+        fixed.init();
+        bench::run_panel_suite(b, fixed, fixed.getPanelLTDC(), "panel_t");
+        arena.free(fixed_fb);
+    }
+    auto fill_buf = (uint8_t*)arena.alloc(480 * 272 * 4 + 4);
+    bench::run_scroll_suite(b, gfx, (uint16_t*)fill_buf);
+    bench::run_fill_suite(b, fill_buf);
+    arena.free(fill_buf);
+    {
+        lgfx::GlyphCache glyphs;
+        glyphs.init(gfx, arena, 32, 40, 256);
+        bench::run_text_suite(b, gfx, glyphs);
+        glyphs.release();
+    }
+    bench::run_bank_suite(b, arena);
+    /// LTDC の読み出しはないので _noscan のみ。通常のメモリでの基準になる
+    bench::run_sdram_suite(b, arena, (uint32_t*)buf, sizeof(buf), &sdram_dma, false);
+    auto stats = bench::run_arena_suite(b, arena);
+    b.end();
+
+    /// 断片化の程度: 空きの合計に対する最大の連続した空きの割合
+    size_t free_total = stats.total - stats.used;
+    fprintf(stderr, "arena: used %zu, largest free %zu / %zu (%u%%), blocks %u, failures %u\n",
+            stats.used, stats.largest_free, free_total,
+            free_total ? (unsigned)(stats.largest_free * 100 / free_total) : 100,
+            (unsigned)stats.blocks, (unsigned)stats.failures);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* dir = argc > 1 ? argv[1] : ".";
+
+    for (int y = 0; y < 48; ++y)
+    {
+        for (int x = 0; x < 64; ++x)
+        {
+            image[x + y * 64] = lgfx::color565(x * 4, y * 5, 255 - x * 4);
+        }
+    }
+
+    arena.init(sdram, sizeof(sdram));
+    /// 実機と同じく 2MiB ごとにバンクを分け、フレームバッファをバンク0 に置く
+    arena.setBankSize(sizeof(sdram) / 4);
+    static LGFX_LTDC_Host gfx((uint8_t*)arena.allocInBanks(480 * 272 * 4, 1 << 0));
+    arena.setDefaultBanks(0b1100);
+    /// DMA2D の転送は別スレッドで行い、完了待ちの漏れを実機と同じように表に出す
+    static host::DMA2D_Device_Thread dma2d_device;
+    gfx.getPanelLTDC().dma2d().setDevice(&dma2d_device);
+    gfx.init();
+
+    /// 画像を SDRAM へ転送する。完了は poll() の中で起きるので、実機の割り込みと同じく後から届く
+    sdram_dma_device.setLatency(4);
+    sdram_dma.setDevice(&sdram_dma_device);
+    sdram_dma.init();
+    image_sdram = (uint16_t*)arena.alloc(sizeof(image));
+    sdram_dma.wait(sdram_dma.copy(image_sdram, image, sizeof(image)));
+
+    if (!strcmp(dir, "--bench"))
+    {
+        return run_benchmark(gfx, argc > 2 ? argv[2] : nullptr);
+    }
+    if (!strcmp(dir, "--check"))
+    {
+        return run_check(gfx, argc > 2 ? argv[2] : nullptr);
+    }
+
+    static constexpr lgfx::color_depth_t depths[] =
+    {
+        lgfx::color_depth_t::rgb565_2Byte,
+        lgfx::color_depth_t::rgb888_3Byte,
+        lgfx::color_depth_t::argb8888_4Byte,
+        lgfx::color_depth_t::rgb332_1Byte,
+    };
+
+    int failed = 0;
+    for (auto depth : depths)
+    {
+        gfx.setColorDepth(depth);
+        for (int r = 0; r < 8; ++r)
+        {
+            gfx.setRotation(r);
+            draw_pattern(gfx);
+
+            char path[256];
+            snprintf(path, sizeof(path), "%s/ltdc_%dbit_r%d.ppm", dir, depth & lgfx::color_depth_t::bit_mask, r);
+            if (!host::ltdc_write_ppm(path))
+            {
+                fprintf(stderr, "failed to write %s\n", path);
+                ++failed;
+            }
+        }
+    }
+    return failed ? 1 : 0;
+}
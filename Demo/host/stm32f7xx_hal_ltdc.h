@@ -0,0 +1,130 @@
+/// ホスト(PC)ビルド用の stm32f7xx_hal_ltdc.h の代替。
+/// Panel_LTDC / DMA2D_Engine が使う型・定数・関数だけを用意する。
+/// レジスタの代わりに host_ltdc.cpp の中でレイヤーの状態を保持し、
+/// host_ltdc_compose() で表示される画像を合成できる。
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum
+{
+    HAL_OK      = 0x00U,
+    HAL_ERROR   = 0x01U,
+    HAL_BUSY    = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef struct
+{
+    volatile uint32_t SRCR;
+} LTDC_TypeDef;
+
+extern LTDC_TypeDef host_ltdc_regs;
+#define LTDC (&host_ltdc_regs)
+
+#define LTDC_SRCR_IMR                 0x00000001U
+#define LTDC_SRCR_VBR                 0x00000002U
+#define LTDC_RELOAD_IMMEDIATE         LTDC_SRCR_IMR
+#define LTDC_RELOAD_VERTICAL_BLANKING LTDC_SRCR_VBR
+
+#define LTDC_PIXEL_FORMAT_ARGB8888    0x00000000U
+#define LTDC_PIXEL_FORMAT_RGB888      0x00000001U
+#define LTDC_PIXEL_FORMAT_RGB565      0x00000002U
+#define LTDC_PIXEL_FORMAT_ARGB1555    0x00000003U
+#define LTDC_PIXEL_FORMAT_ARGB4444    0x00000004U
+#define LTDC_PIXEL_FORMAT_L8          0x00000005U
+#define LTDC_PIXEL_FORMAT_AL44        0x00000006U
+#define LTDC_PIXEL_FORMAT_AL88        0x00000007U
+
+#define LTDC_BLENDING_FACTOR1_CA      0x00000400U
+#define LTDC_BLENDING_FACTOR1_PAxCA   0x00000600U
+#define LTDC_BLENDING_FACTOR2_CA      0x00000005U
+#define LTDC_BLENDING_FACTOR2_PAxCA   0x00000007U
+
+#define LTDC_HSPOLARITY_AL            0x00000000U
+#define LTDC_VSPOLARITY_AL            0x00000000U
+#define LTDC_DEPOLARITY_AL            0x00000000U
+#define LTDC_PCPOLARITY_IPC           0x00000000U
+
+typedef struct
+{
+    uint8_t Blue;
+    uint8_t Green;
+    uint8_t Red;
+    uint8_t Reserved;
+} LTDC_ColorTypeDef;
+
+typedef struct
+{
+    uint32_t HSPolarity;
+    uint32_t VSPolarity;
+    uint32_t DEPolarity;
+    uint32_t PCPolarity;
+    uint32_t HorizontalSync;
+    uint32_t VerticalSync;
+    uint32_t AccumulatedHBP;
+    uint32_t AccumulatedVBP;
+    uint32_t AccumulatedActiveW;
+    uint32_t AccumulatedActiveH;
+    uint32_t TotalWidth;
+    uint32_t TotalHeigh;
+    LTDC_ColorTypeDef Backcolor;
+} LTDC_InitTypeDef;
+
+typedef struct
+{
+    uint32_t WindowX0;
+    uint32_t WindowX1;
+    uint32_t WindowY0;
+    uint32_t WindowY1;
+    uint32_t PixelFormat;
+    uint32_t Alpha;
+    uint32_t Alpha0;
+    uint32_t BlendingFactor1;
+    uint32_t BlendingFactor2;
+    uintptr_t FBStartAdress;   // 実機では uint32_t。ホストのポインタを格納できるようにする
+    uint32_t ImageWidth;
+    uint32_t ImageHeight;
+    LTDC_ColorTypeDef Backcolor;
+} LTDC_LayerCfgTypeDef;
+
+#define MAX_LAYER 2U
+
+typedef struct
+{
+    LTDC_TypeDef*        Instance;
+    LTDC_InitTypeDef     Init;
+    LTDC_LayerCfgTypeDef LayerCfg[MAX_LAYER];
+    uint32_t             State;
+    uint32_t             ErrorCode;
+} LTDC_HandleTypeDef;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+HAL_StatusTypeDef HAL_LTDC_Init(LTDC_HandleTypeDef* hltdc);
+HAL_StatusTypeDef HAL_LTDC_ConfigLayer(LTDC_HandleTypeDef* hltdc, LTDC_LayerCfgTypeDef* pLayerCfg, uint32_t LayerIdx);
+HAL_StatusTypeDef HAL_LTDC_SetPixelFormat(LTDC_HandleTypeDef* hltdc, uint32_t Pixelformat, uint32_t LayerIdx);
+HAL_StatusTypeDef HAL_LTDC_ConfigCLUT(LTDC_HandleTypeDef* hltdc, uint32_t* pCLUT, uint32_t CLUTSize, uint32_t LayerIdx);
+HAL_StatusTypeDef HAL_LTDC_EnableCLUT(LTDC_HandleTypeDef* hltdc, uint32_t LayerIdx);
+HAL_StatusTypeDef HAL_LTDC_DisableCLUT(LTDC_HandleTypeDef* hltdc, uint32_t LayerIdx);
+HAL_StatusTypeDef HAL_LTDC_Reload(LTDC_HandleTypeDef* hltdc, uint32_t ReloadType);
+HAL_StatusTypeDef HAL_LTDC_SetAddress_NoReload(LTDC_HandleTypeDef* hltdc, uintptr_t Address, uint32_t LayerIdx);
+HAL_StatusTypeDef HAL_LTDC_SetPitch(LTDC_HandleTypeDef* hltdc, uint32_t LinePitchInPixels, uint32_t LayerIdx);
+HAL_StatusTypeDef HAL_LTDC_SetPitch_NoReload(LTDC_HandleTypeDef* hltdc, uint32_t LinePitchInPixels, uint32_t LayerIdx);
+HAL_StatusTypeDef HAL_LTDC_SetWindowPosition_NoReload(LTDC_HandleTypeDef* hltdc, uint32_t X0, uint32_t Y0, uint32_t LayerIdx);
+HAL_StatusTypeDef HAL_LTDC_SetAlpha_NoReload(LTDC_HandleTypeDef* hltdc, uint32_t Alpha, uint32_t LayerIdx);
+HAL_StatusTypeDef HAL_LTDC_ConfigColorKeying_NoReload(LTDC_HandleTypeDef* hltdc, uint32_t RGBValue, uint32_t LayerIdx);
+HAL_StatusTypeDef HAL_LTDC_EnableColorKeying_NoReload(LTDC_HandleTypeDef* hltdc, uint32_t LayerIdx);
+HAL_StatusTypeDef HAL_LTDC_DisableColorKeying_NoReload(LTDC_HandleTypeDef* hltdc, uint32_t LayerIdx);
+
+void host_ltdc_layer_enable(LTDC_HandleTypeDef* hltdc, uint32_t LayerIdx, int enable);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define __HAL_LTDC_LAYER_ENABLE(__HANDLE__, __LAYER__)  host_ltdc_layer_enable((__HANDLE__), (__LAYER__), 1)
+#define __HAL_LTDC_LAYER_DISABLE(__HANDLE__, __LAYER__) host_ltdc_layer_enable((__HANDLE__), (__LAYER__), 0)
@@ -0,0 +1,35 @@
+/// ホスト(PC)ビルド用の stm32f7xx_hal_rcc.h の代替。クロック設定は何もしない
+#pragma once
+
+#include "stm32f7xx_hal_ltdc.h"
+
+typedef struct
+{
+    uint32_t PLLSAIN;
+    uint32_t PLLSAIP;
+    uint32_t PLLSAIQ;
+    uint32_t PLLSAIR;
+} RCC_PLLSAIInitTypeDef;
+
+typedef struct
+{
+    uint32_t PeriphClockSelection;
+    RCC_PLLSAIInitTypeDef PLLSAI;
+    uint32_t PLLSAIDivR;
+} RCC_PeriphCLKInitTypeDef;
+
+#define RCC_PERIPHCLK_LTDC  0x00000008U
+#define RCC_PLLSAIDIVR_4    0x00010000U
+
+#define __HAL_RCC_LTDC_CLK_ENABLE()  do { } while (0)
+#define __HAL_RCC_DMA2D_CLK_ENABLE() do { } while (0)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef* PeriphClkInit);
+
+#ifdef __cplusplus
+}
+#endif
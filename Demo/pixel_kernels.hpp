@@ -0,0 +1,880 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined (__SSE2__)
+ #include <emmintrin.h>
+#elif defined (__ARM_NEON)
+ #include <arm_neon.h>
+#endif
+
+namespace lgfx
+{
+    inline namespace v1
+    {
+        namespace kernels
+        {
+            struct px24_t { uint8_t raw[3]; };
+
+            template <size_t Bytes> struct pixel_type;
+            template <> struct pixel_type<1> { using type = uint8_t;  };
+            template <> struct pixel_type<2> { using type = uint16_t; };
+            template <> struct pixel_type<3> { using type = px24_t;   };
+            template <> struct pixel_type<4> { using type = uint32_t; };
+
+            /// 32bit境界から始まる words 語を pattern で埋める。
+            /// ホストでは SSE2/NEON の128bit、それ以外は64bitのストアを展開して使う
+            inline void fill_words(uint32_t* dst, uint32_t pattern, size_t words)
+            {
+#if defined (__SSE2__) || defined (__ARM_NEON)
+                for (; words && ((uintptr_t)dst & 15); --words) { *dst++ = pattern; }
+ #if defined (__SSE2__)
+                __m128i v = _mm_set1_epi32(pattern);
+                for (; words >= 16; words -= 16, dst += 16)
+                {
+                    _mm_store_si128((__m128i*)dst     , v);
+                    _mm_store_si128((__m128i*)dst +  1, v);
+                    _mm_store_si128((__m128i*)dst +  2, v);
+                    _mm_store_si128((__m128i*)dst +  3, v);
+                }
+                for (; words >= 4; words -= 4, dst += 4) { _mm_store_si128((__m128i*)dst, v); }
+ #else
+                uint32x4_t v = vdupq_n_u32(pattern);
+                for (; words >= 16; words -= 16, dst += 16)
+                {
+                    vst1q_u32(dst     , v);
+                    vst1q_u32(dst +  4, v);
+                    vst1q_u32(dst +  8, v);
+                    vst1q_u32(dst + 12, v);
+                }
+                for (; words >= 4; words -= 4, dst += 4) { vst1q_u32(dst, v); }
+ #endif
+#else
+                if (words && ((uintptr_t)dst & 4)) { *dst++ = pattern; --words; }
+                /// Cortex-M7 では STRD になる。1周でキャッシュライン(32byte)を埋める
+                uint64_t p64 = pattern | (uint64_t)pattern << 32;
+                auto d = (uint64_t*)dst;
+                for (; words >= 8; words -= 8, d += 4)
+                {
+                    d[0] = p64;
+                    d[1] = p64;
+                    d[2] = p64;
+                    d[3] = p64;
+                }
+                for (; words >= 2; words -= 2) { *d++ = p64; }
+                dst = (uint32_t*)d;
+#endif
+                if (words & 2) { *dst++ = pattern; *dst++ = pattern; }
+                if (words & 1) { *dst = pattern; }
+            }
+
+            /// n バイトを4バイト周期の pattern (リトルエンディアンの並び) で埋める。
+            /// 先頭・末尾の32bit境界に揃わない部分はバイト単位で書く
+            inline void fill_pattern32(uint8_t* dst, uint32_t pattern, size_t n)
+            {
+                size_t head = std::min<size_t>((0 - (uintptr_t)dst) & 3, n);
+                for (size_t i = 0; i < head; ++i) { dst[i] = pattern >> (i << 3); }
+                dst += head;
+                n -= head;
+                if (head)
+                {
+                    pattern = pattern >> (head << 3) | pattern << (32 - (head << 3));
+                }
+                size_t words = n >> 2;
+                fill_words((uint32_t*)dst, pattern, words);
+                dst += words << 2;
+                for (size_t i = 0; i < (n & 3); ++i) { dst[i] = pattern >> (i << 3); }
+            }
+
+            /// 3バイトの画素 count 個を埋める。12バイト(3語)を1周期として書く
+            inline void fill_pattern24(uint8_t* dst, uint32_t rawcolor, size_t count)
+            {
+                uint8_t b[3] = { (uint8_t)rawcolor, (uint8_t)(rawcolor >> 8), (uint8_t)(rawcolor >> 16) };
+                size_t n = count * 3;
+                size_t head = std::min<size_t>((0 - (uintptr_t)dst) & 3, n);
+                for (size_t i = 0; i < head; ++i) { dst[i] = b[i]; }
+                dst += head;
+                n -= head;
+
+                uint8_t pat[12];
+                for (size_t i = 0; i < 12; ++i) { pat[i] = b[(head + i) % 3]; }
+                uint32_t w[3];
+                memcpy(w, pat, sizeof(w));
+
+                auto d = (uint32_t*)dst;
+                size_t groups = n / 12;
+                for (; groups >= 2; groups -= 2, d += 6)
+                {
+                    d[0] = w[0]; d[1] = w[1]; d[2] = w[2];
+                    d[3] = w[0]; d[4] = w[1]; d[5] = w[2];
+                }
+                if (groups) { d[0] = w[0]; d[1] = w[1]; d[2] = w[2]; d += 3; }
+                memcpy(d, pat, n % 12);
+            }
+
+            /// bytes バイトの画素 rawcolor を count 個並べる
+            inline void fill(void* dst, uint32_t rawcolor, uint_fast8_t bytes, size_t count)
+            {
+                uint32_t pattern;
+                switch (bytes)
+                {
+                case 1:
+                    memset(dst, rawcolor, count);
+                    return;
+
+                case 2:
+                    pattern = (rawcolor & 0xFFFF) * 0x10001u;
+                    break;
+
+                case 3:
+                    if ((rawcolor & 0xFFFFFF) != (rawcolor & 0xFF) * 0x010101u)
+                    {
+                        fill_pattern24((uint8_t*)dst, rawcolor, count);
+                        return;
+                    }
+                    pattern = (rawcolor & 0xFF) * 0x01010101u;
+                    break;
+
+                default:
+                    pattern = rawcolor;
+                    break;
+                }
+                if (pattern == (pattern & 0xFF) * 0x01010101u)
+                {
+                    memset(dst, pattern, count * bytes);
+                    return;
+                }
+                fill_pattern32((uint8_t*)dst, pattern, count * bytes);
+            }
+
+            /// step バイトおきに bytes バイトの画素 rawcolor を count 個 (1以上) 書く。
+            /// 90度・270度系で水平線が縦に並ぶ場合に使う
+            inline void fill_strided(uint8_t* dst, uint32_t rawcolor, uint_fast8_t bytes,
+                                     size_t count, ptrdiff_t step)
+            {
+                switch (bytes)
+                {
+                case 1:
+                    do { *dst = rawcolor; dst += step; } while (--count);
+                    break;
+
+                case 2:
+                    do { *(uint16_t*)dst = rawcolor; dst += step; } while (--count);
+                    break;
+
+                case 3:
+                    do {
+                        dst[0] = rawcolor; dst[1] = rawcolor >> 8; dst[2] = rawcolor >> 16;
+                        dst += step;
+                    } while (--count);
+                    break;
+
+                default:
+                    do { *(uint32_t*)dst = rawcolor; dst += step; } while (--count);
+                    break;
+                }
+            }
+
+            /// 1画素を書く。3バイトの画素はバイト単位で書く
+            template <typename T>
+            inline void store(T* dst, uint32_t rawcolor) { *dst = rawcolor; }
+            inline void store(px24_t* dst, uint32_t rawcolor)
+            {
+                dst->raw[0] = rawcolor;
+                dst->raw[1] = rawcolor >> 8;
+                dst->raw[2] = rawcolor >> 16;
+            }
+
+            /// (x0, y0) から (x1, y1) までの線を両端を含めて描く (Bresenham法)。
+            /// origin は論理座標の原点、sx・sy は論理座標の x・y を1進めたときの画素の移動量。
+            /// 長い方の軸を1画素ずつ進め、誤差の初期値を長さの半分とする (LovyanGFX の drawLine と同じ画素になる)
+            template <typename T>
+            inline void line(T* origin, ptrdiff_t sx, ptrdiff_t sy,
+                             int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t rawcolor)
+            {
+                if ((y1 > y0 ? y1 - y0 : y0 - y1) > (x1 > x0 ? x1 - x0 : x0 - x1))
+                {
+                    std::swap(x0, y0);
+                    std::swap(x1, y1);
+                    std::swap(sx, sy);
+                }
+                if (x0 > x1)
+                {
+                    std::swap(x0, x1);
+                    std::swap(y0, y1);
+                }
+                int32_t dx = x1 - x0;
+                int32_t dy = y1 > y0 ? y1 - y0 : y0 - y1;
+                ptrdiff_t step = y1 > y0 ? sy : -sy;
+                T* dst = origin + x0 * sx + y0 * sy;
+                int32_t err = dx >> 1;
+                int32_t n = dx;
+                for (;;)
+                {
+                    store(dst, rawcolor);
+                    if (!n--) break;
+                    if ((err -= dy) < 0)
+                    {
+                        err += dx;
+                        dst += step;
+                    }
+                    dst += sx;
+                }
+            }
+
+            /// RGB565 のアルファブレンド。alpha は 0〜32 (5bit の色成分に合わせる)。
+            /// 0x07E0F81F で取り出すと 1画素目の B・R と2画素目の G が、(w >> 5) & 0x07C0F83F では残りの成分が
+            /// それぞれ alpha を掛けても隣に溢れない間隔で並ぶ。このため1回の乗算で3成分 (32bit で2画素) を処理できる
+            static constexpr uint32_t mask565_lo = 0x07E0F81Fu;
+            static constexpr uint32_t mask565_hi = 0x07C0F83Fu;
+
+            /// 0〜255 を 0〜32 に丸める
+            inline uint32_t alpha5(uint32_t alpha) { return (alpha + 4) >> 3; }
+
+            /// 0x00RRGGBB を RGB565 (ネイティブ) へ
+            inline uint32_t rgb888_to_rgb565(uint32_t c)
+            {
+                return (c >> 8 & 0xF800) | (c >> 5 & 0x07E0) | (c >> 3 & 0x001F);
+            }
+
+            /// 16bit の2画素それぞれのバイト順を入れ替える (rgb565_2Byte 用)
+            inline uint32_t swap565x2(uint32_t w)
+            {
+                return (w >> 8 & 0x00FF00FFu) | (w << 8 & 0xFF00FF00u);
+            }
+
+            /// 同じ色を同じ alpha で重ねる。色 * alpha は先に求めておく
+            struct blend565x2_t
+            {
+                uint32_t lo;
+                uint32_t hi;
+                uint32_t inv;
+
+                blend565x2_t(uint32_t color565, uint32_t alpha)
+                {
+                    uint32_t c = color565 * 0x10001u;
+                    lo = (c & mask565_lo) * alpha;
+                    hi = (c >> 5 & mask565_hi) * alpha;
+                    inv = 32 - alpha;
+                }
+
+                /// 2画素を重ねる。下位16bitだけに画素がある場合は、結果の下位16bitがその画素になる
+                uint32_t operator()(uint32_t d) const
+                {
+                    uint32_t l = (((d      & mask565_lo) * inv + lo) >> 5) & mask565_lo;
+                    uint32_t h = (((d >> 5 & mask565_hi) * inv + hi) >> 5) & mask565_hi;
+                    return l | h << 5;
+                }
+            };
+
+            /// 画素ごとに alpha が異なる場合の1画素分。画素を 0x07E0F81F の形に広げて1回の乗算で3成分を処理する
+            inline uint32_t blend565(uint32_t dst, uint32_t src, uint32_t alpha)
+            {
+                uint32_t d = (dst | dst << 16) & mask565_lo;
+                uint32_t s = (src | src << 16) & mask565_lo;
+                d = ((d * (32 - alpha) + s * alpha) >> 5) & mask565_lo;
+                return (d | d >> 16) & 0xFFFF;
+            }
+
+            /// RGB565 の画素 count 個に color565 を alpha (1〜31) で重ねる。Swap はバイト順が入れ替わった形式。
+            /// 32bit境界に揃えて2画素ずつ読み書きし、ホストでは SSE2/NEON で8画素ずつ処理する
+            template <bool Swap>
+            void blend_fill565(uint16_t* dst, uint32_t color565, uint32_t alpha, size_t count)
+            {
+                blend565x2_t blend(color565, alpha);
+                if (count && ((uintptr_t)dst & 2))
+                {
+                    uint32_t d = Swap ? swap565x2(*dst) : *dst;
+                    d = blend(d);
+                    *dst++ = Swap ? swap565x2(d) : d;
+                    --count;
+                }
+#if defined (__SSE2__) || defined (__ARM_NEON)
+                /// 成分ごとに (dst * (32 - alpha) + color * alpha) >> 5 を求める。結果は32bitの処理と同じ
+                uint16_t sr = (color565 >> 11) * alpha;
+                uint16_t sg = (color565 >> 5 & 0x3F) * alpha;
+                uint16_t sb = (color565 & 0x1F) * alpha;
+                uint16_t inv = 32 - alpha;
+                for (; count && ((uintptr_t)dst & 15); --count, ++dst)
+                {
+                    uint32_t d = Swap ? swap565x2(*dst) : *dst;
+                    d = blend(d);
+                    *dst = Swap ? swap565x2(d) : d;
+                }
+ #if defined (__SSE2__)
+                const __m128i vr = _mm_set1_epi16(sr), vg = _mm_set1_epi16(sg), vb = _mm_set1_epi16(sb);
+                const __m128i vinv = _mm_set1_epi16(inv);
+                const __m128i m6 = _mm_set1_epi16(0x3F), m5 = _mm_set1_epi16(0x1F);
+                for (; count >= 8; count -= 8, dst += 8)
+                {
+                    __m128i d = _mm_load_si128((const __m128i*)dst);
+                    if (Swap) { d = _mm_or_si128(_mm_slli_epi16(d, 8), _mm_srli_epi16(d, 8)); }
+                    __m128i r = _mm_srli_epi16(d, 11);
+                    __m128i g = _mm_and_si128(_mm_srli_epi16(d, 5), m6);
+                    __m128i b = _mm_and_si128(d, m5);
+                    r = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(r, vinv), vr), 5);
+                    g = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(g, vinv), vg), 5);
+                    b = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(b, vinv), vb), 5);
+                    d = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 11), _mm_slli_epi16(g, 5)), b);
+                    if (Swap) { d = _mm_or_si128(_mm_slli_epi16(d, 8), _mm_srli_epi16(d, 8)); }
+                    _mm_store_si128((__m128i*)dst, d);
+                }
+ #else
+                const uint16x8_t vr = vdupq_n_u16(sr), vg = vdupq_n_u16(sg), vb = vdupq_n_u16(sb);
+                const uint16x8_t m6 = vdupq_n_u16(0x3F), m5 = vdupq_n_u16(0x1F);
+                for (; count >= 8; count -= 8, dst += 8)
+                {
+                    uint16x8_t d = vld1q_u16(dst);
+                    if (Swap) { d = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(d))); }
+                    uint16x8_t r = vshrq_n_u16(d, 11);
+                    uint16x8_t g = vandq_u16(vshrq_n_u16(d, 5), m6);
+                    uint16x8_t b = vandq_u16(d, m5);
+                    r = vshrq_n_u16(vmlaq_n_u16(vr, r, inv), 5);
+                    g = vshrq_n_u16(vmlaq_n_u16(vg, g, inv), 5);
+                    b = vshrq_n_u16(vmlaq_n_u16(vb, b, inv), 5);
+                    d = vorrq_u16(vorrq_u16(vshlq_n_u16(r, 11), vshlq_n_u16(g, 5)), b);
+                    if (Swap) { d = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(d))); }
+                    vst1q_u16(dst, d);
+                }
+ #endif
+#endif
+                auto d = (uint32_t*)dst;
+                for (; count >= 4; count -= 4, d += 2)
+                {
+                    uint32_t a0 = d[0], a1 = d[1];
+                    if (Swap) { a0 = swap565x2(a0); a1 = swap565x2(a1); }
+                    a0 = blend(a0);
+                    a1 = blend(a1);
+                    if (Swap) { a0 = swap565x2(a0); a1 = swap565x2(a1); }
+                    d[0] = a0;
+                    d[1] = a1;
+                }
+                for (; count >= 2; count -= 2, ++d)
+                {
+                    *d = Swap ? swap565x2(blend(swap565x2(*d))) : blend(*d);
+                }
+                if (count)
+                {
+                    auto p = (uint16_t*)d;
+                    uint32_t v = Swap ? swap565x2(*p) : *p;
+                    v = blend(v);
+                    *p = Swap ? swap565x2(v) : v;
+                }
+            }
+
+            /// 0xAARRGGBB の画像を画素ごとの alpha で重ねる
+            template <bool Swap>
+            struct blend_argb8888_565
+            {
+                void operator()(uint16_t& d, uint32_t s) const
+                {
+                    uint32_t a = alpha5(s >> 24);
+                    if (!a) return;
+                    uint32_t c = rgb888_to_rgb565(s);
+                    if (a < 32)
+                    {
+                        c = blend565(Swap ? swap565x2(d) : d, c, a);
+                    }
+                    d = Swap ? swap565x2(c) : c;
+                }
+            };
+
+            /// 8bit の alpha (A8) をマスクとして、同じ色を重ねる
+            template <bool Swap>
+            struct blend_a8_565
+            {
+                uint32_t color565;
+
+                void operator()(uint16_t& d, uint8_t s) const
+                {
+                    uint32_t a = alpha5(s);
+                    if (!a) return;
+                    uint32_t c = color565;
+                    if (a < 32)
+                    {
+                        c = blend565(Swap ? swap565x2(d) : d, c, a);
+                    }
+                    d = Swap ? swap565x2(c) : c;
+                }
+            };
+
+            /// src (spitch画素/行) の w*h 画素を、dst から x方向 dx・y方向 dy 画素ずつ進めながら op(*d, *s) で書く。
+            /// 転置の場合は blit_rotated と同じく、書き込み側が連続アドレスになるようブロック単位で処理する
+            template <typename TD, typename TS, typename F>
+            void apply_rotated(TD* dst, int32_t dx, int32_t dy,
+                               const TS* src, size_t spitch,
+                               uint_fast16_t w, uint_fast16_t h, F op)
+            {
+                if (dx == 1 || dx == -1)
+                {
+                    do {
+                        auto d = dst;
+                        for (uint_fast16_t i = 0; i < w; ++i)
+                        {
+                            op(*d, src[i]);
+                            d += dx;
+                        }
+                        dst += dy;
+                        src += spitch;
+                    } while (--h);
+                    return;
+                }
+
+                static constexpr uint_fast16_t block = 16;
+                for (uint_fast16_t j0 = 0; j0 < h; j0 += block)
+                {
+                    uint_fast16_t jn = std::min<uint_fast16_t>(block, h - j0);
+                    for (uint_fast16_t i0 = 0; i0 < w; i0 += block)
+                    {
+                        uint_fast16_t in = std::min<uint_fast16_t>(block, w - i0);
+                        auto d0 = dst + (int32_t)i0 * dx + (int32_t)j0 * dy;
+                        auto s0 = src + j0 * spitch + i0;
+                        for (uint_fast16_t i = 0; i < in; ++i)
+                        {
+                            auto d = d0;
+                            auto s = s0;
+                            uint_fast16_t j = jn;
+                            do {
+                                op(*d, *s);
+                                d += dy;
+                                s += spitch;
+                            } while (--j);
+                            d0 += dx;
+                            ++s0;
+                        }
+                    }
+                }
+            }
+
+            /// 透過色との比較に使う画素の生の値
+            inline uint32_t raw_value(uint8_t  v) { return v; }
+            inline uint32_t raw_value(uint16_t v) { return v; }
+            inline uint32_t raw_value(uint32_t v) { return v; }
+            inline uint32_t raw_value(const px24_t& v) { return v.raw[0] | v.raw[1] << 8 | v.raw[2] << 16; }
+
+            /// s[i] から透過色 key が続く範囲の終わりを返す。
+            /// 1・2バイトの画素は32bit境界から1語ずつ (4画素・2画素まとめて) 比べる
+            template <typename T>
+            inline size_t skip_key(const T* s, size_t i, size_t w, uint32_t key)
+            {
+                if (sizeof(T) <= 2)
+                {
+                    for (; i < w && ((uintptr_t)(s + i) & 3) && raw_value(s[i]) == key; ++i);
+                    if (!((uintptr_t)(s + i) & 3))
+                    {
+                        static constexpr size_t per_word = 4 / sizeof(T);
+                        uint32_t kw = key * (sizeof(T) == 1 ? 0x01010101u : 0x00010001u);
+                        for (; i + per_word <= w && *(const uint32_t*)(s + i) == kw; i += per_word);
+                    }
+                }
+                for (; i < w && raw_value(s[i]) == key; ++i);
+                return i;
+            }
+
+            /// s[i] から透過色でない画素が続く範囲の終わりを返す。
+            /// 1・2バイトの画素は key と排他的論理和をとった語に 0 の画素があるかを1回で調べる
+            template <typename T>
+            inline size_t find_key(const T* s, size_t i, size_t w, uint32_t key)
+            {
+                if (sizeof(T) <= 2)
+                {
+                    for (; i < w && ((uintptr_t)(s + i) & 3) && raw_value(s[i]) != key; ++i);
+                    if (!((uintptr_t)(s + i) & 3))
+                    {
+                        static constexpr size_t per_word = 4 / sizeof(T);
+                        static constexpr uint32_t lsb = sizeof(T) == 1 ? 0x01010101u : 0x00010001u;
+                        uint32_t kw = key * lsb;
+                        for (; i + per_word <= w; i += per_word)
+                        {
+                            uint32_t x = *(const uint32_t*)(s + i) ^ kw;
+                            if ((x - lsb) & ~x & (lsb << (sizeof(T) * 8 - 1))) break;
+                        }
+                    }
+                }
+                for (; i < w && raw_value(s[i]) != key; ++i);
+                return i;
+            }
+
+            /// n 画素 (1以上) を dx 画素ずつ進めて書く
+            template <typename T>
+            inline void write_run(T* d, ptrdiff_t dx, const T* s, size_t n)
+            {
+                if (dx == 1)
+                {
+                    memcpy(d, s, n * sizeof(T));
+                    return;
+                }
+                do {
+                    *d = *s++;
+                    d += dx;
+                } while (--n);
+            }
+
+            /// blit_rotated の透過色付き版。透過しない画素の連続を探して、その範囲だけを書く
+            template <typename T>
+            void blit_keyed(T* dst, int32_t dx, int32_t dy,
+                            const T* src, size_t spitch,
+                            uint_fast16_t w, uint_fast16_t h, uint32_t key)
+            {
+                do {
+                    size_t i = 0;
+                    while (w != (i = skip_key(src, i, w, key)))
+                    {
+                        size_t e = find_key(src, i, w, key);
+                        write_run(dst + (ptrdiff_t)i * dx, dx, src + i, e - i);
+                        i = e;
+                    }
+                    dst += dy;
+                    src += spitch;
+                } while (--h);
+            }
+
+            inline void blit_keyed_bytes(void* dst, int32_t dx, int32_t dy,
+                                   const void* src, size_t spitch,
+                                   uint_fast16_t w, uint_fast16_t h,
+                                   uint32_t key, uint_fast8_t bytes)
+            {
+                switch (bytes)
+                {
+                case 1:  blit_keyed((uint8_t *)dst, dx, dy, (const uint8_t *)src, spitch, w, h, key & 0xFF    ); break;
+                case 2:  blit_keyed((uint16_t*)dst, dx, dy, (const uint16_t*)src, spitch, w, h, key & 0xFFFF  ); break;
+                case 3:  blit_keyed((px24_t  *)dst, dx, dy, (const px24_t  *)src, spitch, w, h, key & 0xFFFFFF); break;
+                default: blit_keyed((uint32_t*)dst, dx, dy, (const uint32_t*)src, spitch, w, h, key           ); break;
+                }
+            }
+
+            /// 拡大・縮小の1行。cols[i] 番目の画素を dx 画素ずつ進めて書く (最近傍)
+            template <typename T>
+            inline void scale_row(T* d, ptrdiff_t dx, const T* s, const uint16_t* cols, size_t w)
+            {
+                do {
+                    *d = s[*cols++];
+                    d += dx;
+                } while (--w);
+            }
+
+            /// scale_row の透過色付き版
+            template <typename T>
+            inline void scale_row_keyed(T* d, ptrdiff_t dx, const T* s, const uint16_t* cols, size_t w, uint32_t key)
+            {
+                do {
+                    auto& v = s[*cols++];
+                    if (raw_value(v) != key) { *d = v; }
+                    d += dx;
+                } while (--w);
+            }
+
+            /// 32bit を境界に揃えずに書く (Cortex-M7 の STR は非整列でよい)
+            inline void store32(void* d, uint32_t v) { memcpy(d, &v, 4); }
+
+            /// 元の画素 n 個を、それぞれ k 個 (2〜4) ずつ並べる (整数倍の拡大)。
+            /// 1・2バイトの画素は並べた結果を32bit単位で書く
+            template <typename T>
+            inline void replicate(T* d, const T* s, size_t n, uint_fast8_t k)
+            {
+                do {
+                    T v = *s++;
+                    uint_fast8_t i = k;
+                    do { *d++ = v; } while (--i);
+                } while (--n);
+            }
+            inline void replicate(uint16_t* d, const uint16_t* s, size_t n, uint_fast8_t k)
+            {
+                switch (k)
+                {
+                case 2:
+                    do { store32(d, *s++ * 0x10001u); d += 2; } while (--n);
+                    return;
+
+                case 4:
+                    do {
+                        uint32_t v = *s++ * 0x10001u;
+                        store32(d, v);
+                        store32(d + 2, v);
+                        d += 4;
+                    } while (--n);
+                    return;
+
+                default:
+                    /// 2画素を6画素 (3語) にする
+                    for (; n >= 2; n -= 2, s += 2, d += 6)
+                    {
+                        uint32_t a = s[0], b = s[1];
+                        store32(d    , a * 0x10001u);
+                        store32(d + 2, a | b << 16);
+                        store32(d + 4, b * 0x10001u);
+                    }
+                    if (n) { d[0] = d[1] = d[2] = *s; }
+                    return;
+                }
+            }
+            inline void replicate(uint8_t* d, const uint8_t* s, size_t n, uint_fast8_t k)
+            {
+                if (k != 4)
+                {
+                    replicate<uint8_t>(d, s, n, k);
+                    return;
+                }
+                do { store32(d, *s++ * 0x01010101u); d += 4; } while (--n);
+            }
+
+            /// RGB565 の双線形補間の1行。s0・s1 は上下の行、frac は列ごとの右の画素の重み、fy は下の行の重み (いずれも 0〜32)。
+            /// last は元画像の最後の列 (右の画素がはみ出さないようにする)
+            template <bool Swap>
+            inline void bilinear_row565(uint16_t* d, ptrdiff_t dx, const uint16_t* s0, const uint16_t* s1,
+                                        const uint16_t* cols, const uint8_t* frac, size_t w,
+                                        uint32_t fy, uint_fast16_t last)
+            {
+                do {
+                    uint_fast16_t c0 = *cols++;
+                    uint_fast16_t c1 = c0 < last ? c0 + 1 : c0;
+                    uint32_t fx = *frac++;
+                    uint32_t a = s0[c0], b = s0[c1];
+                    if (Swap) { a = swap565x2(a); b = swap565x2(b); }
+                    uint32_t v = blend565(a, b, fx);
+                    if (fy)
+                    {
+                        a = s1[c0];
+                        b = s1[c1];
+                        if (Swap) { a = swap565x2(a); b = swap565x2(b); }
+                        v = blend565(v, blend565(a, b, fx), fy);
+                    }
+                    *d = Swap ? swap565x2(v) : v;
+                    d += dx;
+                } while (--w);
+            }
+
+            /// n バイトを複写する。dst と src は重なっていてもよい。
+            /// 32bit境界からのずれが同じ場合は、8語(キャッシュライン)ずつ読んでから書く
+            inline void move_bytes(uint8_t* dst, const uint8_t* src, size_t n)
+            {
+                if (((uintptr_t)dst ^ (uintptr_t)src) & 3)
+                {
+                    memmove(dst, src, n);
+                    return;
+                }
+                if (dst <= src || dst >= src + n)
+                {
+                    for (; n && ((uintptr_t)dst & 3); --n) { *dst++ = *src++; }
+                    auto d = (uint32_t*)dst;
+                    auto s = (const uint32_t*)src;
+                    for (; n >= 32; n -= 32, d += 8, s += 8)
+                    {
+                        uint32_t a0 = s[0], a1 = s[1], a2 = s[2], a3 = s[3];
+                        uint32_t a4 = s[4], a5 = s[5], a6 = s[6], a7 = s[7];
+                        d[0] = a0; d[1] = a1; d[2] = a2; d[3] = a3;
+                        d[4] = a4; d[5] = a5; d[6] = a6; d[7] = a7;
+                    }
+                    for (; n >= 4; n -= 4) { *d++ = *s++; }
+                    dst = (uint8_t*)d;
+                    src = (const uint8_t*)s;
+                    while (n--) { *dst++ = *src++; }
+                    return;
+                }
+                /// dst が後ろに重なる場合は末尾から複写する
+                dst += n;
+                src += n;
+                for (; n && ((uintptr_t)dst & 3); --n) { *--dst = *--src; }
+                auto d = (uint32_t*)dst;
+                auto s = (const uint32_t*)src;
+                for (; n >= 32; n -= 32)
+                {
+                    d -= 8;
+                    s -= 8;
+                    uint32_t a0 = s[0], a1 = s[1], a2 = s[2], a3 = s[3];
+                    uint32_t a4 = s[4], a5 = s[5], a6 = s[6], a7 = s[7];
+                    d[0] = a0; d[1] = a1; d[2] = a2; d[3] = a3;
+                    d[4] = a4; d[5] = a5; d[6] = a6; d[7] = a7;
+                }
+                for (; n >= 4; n -= 4) { *--d = *--s; }
+                dst = (uint8_t*)d;
+                src = (const uint8_t*)s;
+                while (n--) { *--dst = *--src; }
+            }
+
+            /// src (spitch画素/行) の w*h 画素を、dst から x方向 dx・y方向 dy 画素ずつ進めて書く。
+            /// dx が ±1 でない場合(90度・270度系)は 16x16 のブロック単位で転置し、
+            /// 書き込み側が連続アドレスになるようにする。
+            template <typename T>
+            void blit_rotated(T* dst, int32_t dx, int32_t dy,
+                              const T* src, size_t spitch,
+                              uint_fast16_t w, uint_fast16_t h)
+            {
+                if (dx == 1)
+                {
+                    do {
+                        memcpy(dst, src, w * sizeof(T));
+                        dst += dy;
+                        src += spitch;
+                    } while (--h);
+                    return;
+                }
+                if (dx == -1)
+                {
+                    do {
+                        auto d = dst;
+                        for (uint_fast16_t i = 0; i < w; ++i)
+                        {
+                            *d-- = src[i];
+                        }
+                        dst += dy;
+                        src += spitch;
+                    } while (--h);
+                    return;
+                }
+
+                static constexpr uint_fast16_t block = 16;
+                for (uint_fast16_t j0 = 0; j0 < h; j0 += block)
+                {
+                    uint_fast16_t jn = std::min<uint_fast16_t>(block, h - j0);
+                    for (uint_fast16_t i0 = 0; i0 < w; i0 += block)
+                    {
+                        uint_fast16_t in = std::min<uint_fast16_t>(block, w - i0);
+                        auto d0 = dst + (int32_t)i0 * dx + (int32_t)j0 * dy;
+                        auto s0 = src + j0 * spitch + i0;
+                        for (uint_fast16_t i = 0; i < in; ++i)
+                        {
+                            auto d = d0;
+                            auto s = s0;
+                            uint_fast16_t j = jn;
+                            do {
+                                *d = *s;
+                                d += dy;
+                                s += spitch;
+                            } while (--j);
+                            d0 += dx;
+                            ++s0;
+                        }
+                    }
+                }
+            }
+
+            inline void blit_rotated_bytes(void* dst, int32_t dx, int32_t dy,
+                                     const void* src, size_t spitch,
+                                     uint_fast16_t w, uint_fast16_t h,
+                                     uint_fast8_t bytes)
+            {
+                switch (bytes)
+                {
+                case 1:  blit_rotated((uint8_t *)dst, dx, dy, (const uint8_t *)src, spitch, w, h); break;
+                case 2:  blit_rotated((uint16_t*)dst, dx, dy, (const uint16_t*)src, spitch, w, h); break;
+                case 3:  blit_rotated((px24_t  *)dst, dx, dy, (const px24_t  *)src, spitch, w, h); break;
+                default: blit_rotated((uint32_t*)dst, dx, dy, (const uint32_t*)src, spitch, w, h); break;
+                }
+            }
+
+            /// fb (物理座標の原点) から x方向 dx・y方向 dy 画素ずつ進めて読み、
+            /// conv で変換して dst へ w 画素/行で詰めて書く。
+            /// 転置の場合は読み出し側が連続アドレスになるようブロック単位で処理する
+            template <typename TD, typename TS, typename F>
+            void read_rotated(TD* dst, const TS* src, int32_t dx, int32_t dy,
+                              uint_fast16_t w, uint_fast16_t h, F conv)
+            {
+                if (dx == 1 || dx == -1)
+                {
+                    do {
+                        auto s = src;
+                        for (uint_fast16_t i = 0; i < w; ++i)
+                        {
+                            dst[i] = conv(*s);
+                            s += dx;
+                        }
+                        dst += w;
+                        src += dy;
+                    } while (--h);
+                    return;
+                }
+
+                static constexpr uint_fast16_t block = 16;
+                for (uint_fast16_t j0 = 0; j0 < h; j0 += block)
+                {
+                    uint_fast16_t jn = std::min<uint_fast16_t>(block, h - j0);
+                    for (uint_fast16_t i0 = 0; i0 < w; i0 += block)
+                    {
+                        uint_fast16_t in = std::min<uint_fast16_t>(block, w - i0);
+                        auto s0 = src + (int32_t)i0 * dx + (int32_t)j0 * dy;
+                        auto d0 = dst + j0 * w + i0;
+                        for (uint_fast16_t i = 0; i < in; ++i)
+                        {
+                            auto s = s0;
+                            auto d = d0;
+                            uint_fast16_t j = jn;
+                            do {
+                                *d = conv(*s);
+                                s += dy;
+                                d += w;
+                            } while (--j);
+                            s0 += dx;
+                            ++d0;
+                        }
+                    }
+                }
+            }
+
+            struct conv_none
+            {
+                template <typename T>
+                T operator()(const T& v) const { return v; }
+            };
+
+            inline void read_rotated_bytes(void* dst, const void* src, int32_t dx, int32_t dy,
+                                     uint_fast16_t w, uint_fast16_t h,
+                                     uint_fast8_t bytes)
+            {
+                switch (bytes)
+                {
+                case 1:  read_rotated((uint8_t *)dst, (const uint8_t *)src, dx, dy, w, h, conv_none()); break;
+                case 2:  read_rotated((uint16_t*)dst, (const uint16_t*)src, dx, dy, w, h, conv_none()); break;
+                case 3:  read_rotated((px24_t  *)dst, (const px24_t  *)src, dx, dy, w, h, conv_none()); break;
+                default: read_rotated((uint32_t*)dst, (const uint32_t*)src, dx, dy, w, h, conv_none()); break;
+                }
+            }
+
+            /// RGB565 (ネイティブ) を 0x00RRGGBB へ。下位ビットは上位ビットの複製で埋める
+            inline uint32_t rgb565_to_rgb888(uint32_t v)
+            {
+                uint32_t r = (v >> 8) & 0xF8; r |= r >> 5;
+                uint32_t g = (v >> 3) & 0xFC; g |= g >> 6;
+                uint32_t b = (v << 3) & 0xF8; b |= b >> 5;
+                return r << 16 | g << 8 | b;
+            }
+
+            /// SrcSwap/DstSwap はバイト順が入れ替わった (xxx_nByte) 形式であることを示す
+            template <bool SrcSwap, bool DstSwap>
+            struct conv_565_to_565
+            {
+                uint16_t operator()(uint16_t v) const
+                {
+                    return (SrcSwap != DstSwap) ? __builtin_bswap16(v) : v;
+                }
+            };
+
+            template <bool SrcSwap, bool DstSwap>
+            struct conv_565_to_888
+            {
+                px24_t operator()(uint16_t v) const
+                {
+                    uint32_t c = rgb565_to_rgb888(SrcSwap ? __builtin_bswap16(v) : v);
+                    px24_t p;
+                    p.raw[DstSwap ? 2 : 0] = c;
+                    p.raw[1] = c >> 8;
+                    p.raw[DstSwap ? 0 : 2] = c >> 16;
+                    return p;
+                }
+            };
+
+            template <bool SrcSwap, bool DstSwap>
+            struct conv_565_to_8888
+            {
+                uint32_t operator()(uint16_t v) const
+                {
+                    uint32_t c = 0xFF000000u | rgb565_to_rgb888(SrcSwap ? __builtin_bswap16(v) : v);
+                    return DstSwap ? __builtin_bswap32(c) : c;
+                }
+            };
+        }
+    }
+}
@@ -40,6 +40,9 @@
         o If interrupt mode is used for DMA transfer, the function BSP_SDRAM_DMA_IRQHandler()
           is called in IRQ handler file, to serve the generated interrupt once the DMA 
           transfer is complete.
+        o BSP_SDRAM_DMA_Start() starts a memory to memory transfer and returns without
+          waiting. The callback registered with BSP_SDRAM_DMA_RegisterCallback() is called
+          from BSP_SDRAM_DMA_IRQHandler() when the transfer completes or fails.
         o You can send a command to the SDRAM device in runtime using the function 
           BSP_SDRAM_Sendcmd(), and giving the desired command as parameter chosen between 
           the predefined commands of the "FMC_SDRAM_CommandTypeDef" structure. 
@@ -117,6 +120,7 @@
 static SDRAM_HandleTypeDef sdramHandle;
 static FMC_SDRAM_TimingTypeDef Timing;
 static FMC_SDRAM_CommandTypeDef Command;
+static void (*DMA_CpltCallback)(uint8_t Status);
 /**
   * @}
   */ 
@@ -124,6 +128,8 @@ static FMC_SDRAM_CommandTypeDef Command;
 /** @defgroup STM32746G_DISCOVERY_SDRAM_Private_Function_Prototypes STM32746G_DISCOVERY_SDRAM Private Function Prototypes
   * @{
   */ 
+static void SDRAM_DMA_XferCpltCallback(DMA_HandleTypeDef *hdma);
+static void SDRAM_DMA_XferErrorCallback(DMA_HandleTypeDef *hdma);
 /**
   * @}
   */
@@ -342,6 +348,60 @@ uint8_t BSP_SDRAM_WriteData_DMA(uint32_t uwStartAddress, uint32_t *pData, uint32
   } 
 }
 
+/**
+  * @brief  Starts a DMA transfer between memories without waiting for its completion.
+  * @note   The callback registered with BSP_SDRAM_DMA_RegisterCallback() is called
+  *         from BSP_SDRAM_DMA_IRQHandler() when the transfer is finished.
+  * @param  uwSrcAddress: Source address (32-bit aligned)
+  * @param  uwDstAddress: Destination address (32-bit aligned)
+  * @param  uwDataSize: Number of 32-bit words to transfer (1 to 0xFFFF)
+  * @retval SDRAM status
+  */
+uint8_t BSP_SDRAM_DMA_Start(uint32_t uwSrcAddress, uint32_t uwDstAddress, uint32_t uwDataSize)
+{
+  DMA_HandleTypeDef *hdma = sdramHandle.hdma;
+
+  if((hdma == NULL) || (uwDataSize == 0) || (uwDataSize > 0xFFFF))
+  {
+    return SDRAM_ERROR;
+  }
+
+  /* The handle may have been used by BSP_SDRAM_ReadData_DMA()/BSP_SDRAM_WriteData_DMA() */
+  hdma->XferCpltCallback     = SDRAM_DMA_XferCpltCallback;
+  hdma->XferHalfCpltCallback = NULL;
+  hdma->XferErrorCallback    = SDRAM_DMA_XferErrorCallback;
+
+  if(HAL_DMA_Start_IT(hdma, uwSrcAddress, uwDstAddress, uwDataSize) != HAL_OK)
+  {
+    return SDRAM_ERROR;
+  }
+  else
+  {
+    return SDRAM_OK;
+  }
+}
+
+/**
+  * @brief  Returns whether a DMA transfer is in progress.
+  * @retval 1 if busy, 0 otherwise
+  */
+uint8_t BSP_SDRAM_DMA_IsBusy(void)
+{
+  return (sdramHandle.hdma != NULL) && (HAL_DMA_GetState(sdramHandle.hdma) == HAL_DMA_STATE_BUSY);
+}
+
+/**
+  * @brief  Registers the function called when a transfer started by
+  *         BSP_SDRAM_DMA_Start() is finished.
+  * @param  pCallback: Callback, called from interrupt context with SDRAM_OK or SDRAM_ERROR.
+  *         The next transfer can be started from inside the callback.
+  * @retval None
+  */
+void BSP_SDRAM_DMA_RegisterCallback(void (*pCallback)(uint8_t Status))
+{
+  DMA_CpltCallback = pCallback;
+}
+
 /**
   * @brief  Sends command to the SDRAM bank.
   * @param  SdramCmd: Pointer to SDRAM command structure 
@@ -368,6 +428,44 @@ void BSP_SDRAM_DMA_IRQHandler(void)
   HAL_DMA_IRQHandler(sdramHandle.hdma); 
 }
 
+#if !defined (SDRAM_DMA_NO_IRQHANDLER)
+/**
+  * @brief  DMA stream interrupt handler. The interrupt is enabled in BSP_SDRAM_MspInit().
+  *         Define SDRAM_DMA_NO_IRQHANDLER if the application provides its own handler.
+  * @retval None
+  */
+void SDRAM_DMAx_IRQHandler(void)
+{
+  BSP_SDRAM_DMA_IRQHandler();
+}
+#endif
+
+/**
+  * @brief  DMA transfer complete callback for BSP_SDRAM_DMA_Start().
+  * @param  hdma: DMA handle
+  * @retval None
+  */
+static void SDRAM_DMA_XferCpltCallback(DMA_HandleTypeDef *hdma)
+{
+  if(DMA_CpltCallback != NULL)
+  {
+    DMA_CpltCallback(SDRAM_OK);
+  }
+}
+
+/**
+  * @brief  DMA transfer error callback for BSP_SDRAM_DMA_Start().
+  * @param  hdma: DMA handle
+  * @retval None
+  */
+static void SDRAM_DMA_XferErrorCallback(DMA_HandleTypeDef *hdma)
+{
+  if(DMA_CpltCallback != NULL)
+  {
+    DMA_CpltCallback(SDRAM_ERROR);
+  }
+}
+
 /**
   * @brief  Initializes SDRAM MSP.
   * @param  hsdram: SDRAM handle
@@ -133,6 +133,9 @@ uint8_t BSP_SDRAM_WriteData(uint32_t uwStartAddress, uint32_t *pData, uint32_t u
 uint8_t BSP_SDRAM_WriteData_DMA(uint32_t uwStartAddress, uint32_t *pData, uint32_t uwDataSize);
 uint8_t BSP_SDRAM_Sendcmd(FMC_SDRAM_CommandTypeDef *SdramCmd);
 void    BSP_SDRAM_DMA_IRQHandler(void);  
+uint8_t BSP_SDRAM_DMA_Start(uint32_t uwSrcAddress, uint32_t uwDstAddress, uint32_t uwDataSize);
+uint8_t BSP_SDRAM_DMA_IsBusy(void);
+void    BSP_SDRAM_DMA_RegisterCallback(void (*pCallback)(uint8_t Status));
    
 /* These functions can be modified in case the current settings (e.g. DMA stream)
    need to be changed for specific application needs */